@@ -1,80 +1,516 @@
 #include "Data.hpp"
+#include "DataCodec.hpp"
+#include "DataDictionary.hpp"
 
-Data::Data(const String& str)
-  : _type(DataType::String), _data{ ._str = new String(str) } {}
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <new>
 
-Data::Data(String&& str)
-  : _type(DataType::String), _data{ ._str = new String(str) } {}
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "numeric arrays and floats are copied as little-endian bytes");
 
-Data::Data(const char* str)
-  : _type(str == nullptr ? DataType::Null : DataType::String), _data{ ._str = (str == nullptr ? nullptr : new String(str)) } {}
+// 要素数とバイト数はuint16_tで書き込むため、これを超える値はシリアライズできません。
+static const constexpr size_t MAX_SERIALIZED_LENGTH = 0xFFFF;
 
-Data::Data(const std::vector<Data>& array)
-  : _type(DataType::Array), _data{ ._array = new std::vector<Data>(array) } {}
+// 数値配列型の要素のバイト数を返します。
+// 数値配列型はInt8ArrayからUInt64Arrayまで8, 16, 32, 64bitの順に2回並んでいます。
+static size_t element_size(DataType type) noexcept {
+  return static_cast<size_t>(1) << ((static_cast<uint8_t>(type) - static_cast<uint8_t>(DataType::Int8Array)) & 3);
+}
 
-Data::Data(std::vector<Data>&& array)
-  : _type(DataType::Array), _data{ ._array = new std::vector<Data>(array) } {}
+// 数値配列型の型タグを返します。
+static uint8_t array_tag(DataType type) noexcept {
+  return TYPE_INT8_ARRAY + (static_cast<uint8_t>(type) - static_cast<uint8_t>(DataType::Int8Array));
+}
 
-Data::Data(std::initializer_list<Data> array)
-  : _type(DataType::Array), _data{ ._array = new std::vector<Data>(array) } {}
+// 型タグが数値配列型の場合はそのデータ型を、そうでない場合はNullを返します。
+static DataType array_type(uint8_t tag) noexcept {
+  return tag >= TYPE_INT8_ARRAY && tag <= TYPE_UINT64_ARRAY
+           ? static_cast<DataType>(static_cast<uint8_t>(DataType::Int8Array) + (tag - TYPE_INT8_ARRAY))
+           : DataType::Null;
+}
 
-Data::Data(const Data& other)
-  : _type(other._type) {
-  if (other._type == DataType::String)
-    _data._str = new String(*other._data._str);
-  else if (other._type == DataType::Array)
-    _data._array = new std::vector<Data>(*other._data._array);
-  else
-    _data = other._data;
+/*
+  一つのメッセージの文字列と配列をまとめて格納する領域
+  領域内の文字列と配列は個別の参照カウントをもたず、領域の参照カウントを共有します。
+  領域内のデータは領域の参照を保持しないため、領域の解放時にデストラクタを呼び出す必要はありません。
+  ただし辞書の文字列を共有するデータは、領域の解放時にまとめて参照を解放します。
+*/
+struct alignas(Data) Data::Arena {
+  // 領域内のデータが参照する領域外のブロックの一覧
+  struct Shared {
+    BytesBlock* block;
+    Shared* next;
+  };
+
+  std::atomic<uint32_t> refs;
+  size_t capacity;
+  size_t used;
+  Shared* shared;
+
+  static size_t align(size_t size) noexcept {
+    return (size + alignof(Data) - 1) & ~(alignof(Data) - 1);
+  }
+
+  static Arena* create(size_t capacity) {
+    Arena* arena = new (::operator new(sizeof(Arena) + capacity)) Arena;
+    arena->refs.store(1, std::memory_order_relaxed);
+    arena->capacity = capacity;
+    arena->used = 0;
+    arena->shared = nullptr;
+    return arena;
+  }
+
+  // 領域外のブロックの参照を解放して、領域を空にします（他に参照がない場合だけ呼び出します）。
+  void reset() noexcept;
+
+  void* allocate(size_t size) noexcept {
+    void* p = reinterpret_cast<uint8_t*>(this + 1) + used;
+    used += align(size);
+    return p;
+  }
+
+  void retain() noexcept {
+    refs.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // 領域外のブロックの参照を領域に持たせます。
+  void share(BytesBlock* block) noexcept {
+    Shared* entry = new (allocate(sizeof(Shared))) Shared{ block, shared };
+    shared = entry;
+  }
+
+  void release() noexcept;
+};
+
+/*
+  文字列型と数値配列型の値を共有するための参照カウント付きブロック
+  値はブロックの直後に格納され、文字列の場合は終端文字が続きます。
+  参照カウントは両方のコアから操作されるため、アトミックに増減します。
+*/
+struct alignas(Data) Data::BytesBlock {
+  std::atomic<uint32_t> refs;
+  Arena* arena;   // 領域内に確保された場合はその領域
+  size_t length;  // 値のバイト数
+
+  char* chars() noexcept {
+    return reinterpret_cast<char*>(this + 1);
+  }
+
+  static size_t allocation_size(size_t len) noexcept {
+    return sizeof(BytesBlock) + len + 1;
+  }
+
+  // bytesがnullptrの場合は値を0で埋めます。
+  static BytesBlock* create(const void* bytes, size_t len, Arena* arena = nullptr) {
+    void* p = arena != nullptr ? arena->allocate(allocation_size(len)) : ::operator new(allocation_size(len));
+    BytesBlock* block = new (p) BytesBlock;
+    block->refs.store(1, std::memory_order_relaxed);
+    block->arena = arena;
+    block->length = len;
+    if (bytes == nullptr)
+      memset(block->chars(), 0, len);
+    else if (len != 0)
+      memcpy(block->chars(), bytes, len);
+    block->chars()[len] = '\0';
+    return block;
+  }
+
+  BytesBlock* retain() noexcept {
+    if (arena != nullptr)
+      arena->retain();
+    else
+      refs.fetch_add(1, std::memory_order_relaxed);
+    return this;
+  }
+
+  void release() noexcept {
+    if (arena != nullptr)
+      arena->release();
+    else if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      this->~BytesBlock();
+      ::operator delete(this);
+    }
+  }
+};
+
+void Data::Arena::reset() noexcept {
+  for (Shared* entry = shared; entry != nullptr; entry = entry->next)
+    entry->block->release();
+  shared = nullptr;
+  used = 0;
 }
 
-Data::Data(Data&& other)
-  : _type(other._type) {
-  if (other._type == DataType::String)
-    _data._str = new String(std::move(*other._data._str));
-  else if (other._type == DataType::Array)
-    _data._array = new std::vector<Data>(std::move(*other._data._array));
+void Data::Arena::release() noexcept {
+  if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    for (Shared* entry = shared; entry != nullptr; entry = entry->next)
+      entry->block->release();
+    this->~Arena();
+    ::operator delete(this);
+  }
+}
+
+/*
+  配列型の値は参照カウントで共有します。
+  参照カウントは両方のコアから操作されるため、アトミックに増減します。
+*/
+size_t DataArray::_allocationSize(size_t size) noexcept {
+  return sizeof(DataArray) + size * sizeof(Data);
+}
+
+// 要素がすべてNullの配列を確保します。
+DataArray* DataArray::_create(size_t size, Data::Arena* arena) {
+  void* p = arena != nullptr ? arena->allocate(_allocationSize(size)) : ::operator new(_allocationSize(size));
+  DataArray* array = new (p) DataArray;
+  array->_arena = arena;
+  array->_size = size;
+  for (size_t i = 0; i < size; ++i)
+    new (array->_items() + i) Data();
+  return array;
+}
+
+template<class Iterator>
+DataArray* DataArray::_create(Iterator first, size_t size) {
+  DataArray* array = _create(size);
+  for (size_t i = 0; i < size; ++i, ++first)
+    array->_items()[i] = *first;
+  return array;
+}
+
+DataArray* DataArray::_retain() noexcept {
+  if (_arena != nullptr)
+    _arena->retain();
   else
-    _data = other._data;
+    _refs.fetch_add(1, std::memory_order_relaxed);
+  return this;
 }
 
-Data::~Data() {
-  if (_type == DataType::String)
-    delete _data._str;
-  else if (_type == DataType::Array)
-    delete _data._array;
+void DataArray::_release() noexcept {
+  if (_arena != nullptr)
+    _arena->release();
+  else if (_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    for (size_t i = 0; i < _size; ++i)
+      _items()[i].~Data();
+    this->~DataArray();
+    ::operator delete(this);
+  }
 }
 
-Data& Data::operator=(const Data& other) {
+// 他のデータと共有されていない場合はそのまま、共有されている場合は複製した配列を返します。
+// 領域内の配列は常に複製します。
+DataArray* DataArray::_unique() {
+  if (_arena == nullptr && _refs.load(std::memory_order_acquire) == 1)
+    return this;
+  DataArray* array = _create(begin(), _size);
+  _release();
+  return array;
+}
+
+const Data& DataArray::at(size_t index) const noexcept {
+  static const Data null;
+  return index < _size ? begin()[index] : null;
+}
+
+void Data::_initString(const char* str, size_t len) {
+  static_assert(offsetof(Data, _small_len) + 1 == SMALL_STRING_OFFSET, "unexpected Data layout");
+  static_assert(sizeof(Data) - SMALL_STRING_OFFSET >= SMALL_STRING_CAPACITY + 1, "small string does not fit in Data");
+  _type = DataType::String;
+  if (len <= SMALL_STRING_CAPACITY) {
+    _small_len = len;
+    memcpy(_small(), str, len);
+    _small()[len] = '\0';
+  } else {
+    _small_len = LARGE_STRING;
+    _data._str = BytesBlock::create(str, len);
+  }
+}
+
+void Data::_release() noexcept {
+  if (_type == DataType::String) {
+    if (_small_len == LARGE_STRING)
+      _data._str->release();
+  } else if (_type == DataType::Array)
+    _data._array->_release();
+  else if (_isNumbers() || _isEncoded())
+    _data._numbers->release();
+}
+
+Data::Arena* Data::_rootArena() const noexcept {
   if (_type == DataType::String)
-    delete _data._str;
-  else if (_type == DataType::Array)
-    delete _data._array;
+    return _small_len == LARGE_STRING ? _data._str->arena : nullptr;
+  if (_type == DataType::Array)
+    return _data._array->_arena;
+  if (_isNumbers() || _isEncoded())
+    return _data._numbers->arena;
+  return nullptr;
+}
+
+void Data::_copyFrom(const Data& other) {
   _type = other._type;
-  if (other._type == DataType::String)
-    _data._str = new String(*other._data._str);
+  _small_len = other._small_len;
+  if (other._isSmall())
+    memcpy(_small(), other._small(), _small_len + 1);
+  else if (other._type == DataType::String)
+    _data._str = other._data._str->retain();
   else if (other._type == DataType::Array)
-    _data._array = new std::vector<Data>(*other._data._array);
+    _data._array = other._data._array->_retain();
+  else if (other._isNumbers() || other._isEncoded())
+    _data._numbers = other._data._numbers->retain();
   else
     _data = other._data;
+}
+
+void Data::_moveFrom(Data& other) noexcept {
+  memcpy(static_cast<void*>(this), static_cast<const void*>(&other), sizeof(Data));
+  other._type = DataType::Null;
+  other._small_len = LARGE_STRING;
+  other._data._null = nullptr;
+}
+
+void Data::_adopt(BytesBlock* bytes, DataType type) noexcept {
+  _release();
+  _type = type;
+  _small_len = LARGE_STRING;
+  _data._str = bytes;
+}
+
+void Data::_adopt(DataArray* array) noexcept {
+  _release();
+  _type = DataType::Array;
+  _data._array = array;
+}
+
+/*
+  配列型の値を一つの連続した領域に構築します。
+  要素の直後に、長い文字列と数値配列の値、入れ子の配列をすべて複製して詰めて格納するため、
+  メモリの確保は一回で済み、要素を順に読むときもメモリ上を先頭から順に読むことになります。
+  配列の外に格納する値がない場合や、入れ子がDATA_MAX_DEPTHを超える場合は、要素を共有する配列を構築します。
+*/
+void Data::_initArray(const Data* items, size_t size) {
+  _type = DataType::Array;
+  struct Frame {
+    const Data* next;
+    Data* dest;
+    size_t rest;
+  };
+  Frame stack[DATA_MAX_DEPTH];
+  size_t depth = 0;
+  size_t bytes = Arena::align(DataArray::_allocationSize(size));
+  bool flat = false;  // 配列の外に格納する値があるか
+  stack[depth++] = Frame{ items, nullptr, size };
+  while (depth > 0) {
+    Frame& frame = stack[depth - 1];
+    if (frame.rest == 0) {
+      --depth;
+      continue;
+    }
+    --frame.rest;
+    const Data& item = *frame.next++;
+    if (item._type == DataType::Array) {
+      if (depth == DATA_MAX_DEPTH) {
+        flat = false;
+        break;
+      }
+      bytes += Arena::align(DataArray::_allocationSize(item._data._array->_size));
+      stack[depth++] = Frame{ item._data._array->begin(), nullptr, item._data._array->_size };
+      flat = true;
+    } else if ((item._type == DataType::String && !item._isSmall()) || item._isNumbers() || item._isEncoded()) {
+      bytes += Arena::align(BytesBlock::allocation_size(item._data._str->length));
+      flat = true;
+    }
+  }
+  if (!flat) {
+    _data._array = DataArray::_create(items, size);
+    return;
+  }
+
+  Arena* arena = Arena::create(bytes);
+  DataArray* array = DataArray::_create(size, arena);
+  depth = 0;
+  stack[depth++] = Frame{ items, array->_items(), size };
+  while (depth > 0) {
+    Frame& frame = stack[depth - 1];
+    if (frame.rest == 0) {
+      --depth;
+      continue;
+    }
+    --frame.rest;
+    const Data& item = *frame.next++;
+    Data* dest = frame.dest++;
+    if (item._type == DataType::Array) {
+      DataArray* child = DataArray::_create(item._data._array->_size, arena);
+      dest->_adopt(child);
+      stack[depth++] = Frame{ item._data._array->begin(), child->_items(), child->_size };
+    } else if ((item._type == DataType::String && !item._isSmall()) || item._isNumbers() || item._isEncoded())
+      dest->_adopt(BytesBlock::create(item._data._str->chars(), item._data._str->length, arena), item._type);
+    else
+      *dest = item;
+  }
+  // 配列が領域の最初の参照を引き継ぎます。
+  _data._array = array;
+}
+
+void Data::_initNumbers(DataType type, const void* values, size_t count) {
+  _type = type;
+  _data._numbers = BytesBlock::create(values, count * element_size(type));
+}
+
+void Data::_initEncoded(DataType type, const void* bytes, size_t len) {
+  _type = type;
+  _data._numbers = BytesBlock::create(bytes, len);
+}
+
+const uint8_t* Data::_encoded(DataType type, size_t& len) const noexcept {
+  if (_type != type) {
+    len = 0;
+    return nullptr;
+  }
+  len = _data._numbers->length;
+  return reinterpret_cast<const uint8_t*>(_data._numbers->chars());
+}
+
+const void* Data::_values(DataType type) const noexcept {
+  return _type == type ? _data._numbers->chars() : nullptr;
+}
+
+template<class T>
+std::vector<T> Data::_toVector() const {
+  const T* first = values<T>();
+  return first != nullptr ? std::vector<T>(first, first + size()) : std::vector<T>();
+}
+
+const char* Data::_chars() const noexcept {
+  return _isSmall() ? _small() : _data._str->chars();
+}
+
+size_t Data::_length() const noexcept {
+  return _isSmall() ? _small_len : _data._str->length;
+}
+
+Data::Data(const String& str) {
+  _initString(str.c_str(), str.length());
+}
+
+Data::Data(String&& str) {
+  _initString(str.c_str(), str.length());
+}
+
+Data::Data(const char* str) {
+  if (str == nullptr) {
+    _type = DataType::Null;
+    _data._null = nullptr;
+  } else
+    _initString(str, strlen(str));
+}
+
+Data::Data(const char* str, size_t len) {
+  _initString(str, len);
+}
+
+Data::Data(const int8_t* values, size_t count) {
+  _initNumbers(DataType::Int8Array, values, count);
+}
+
+Data::Data(const int16_t* values, size_t count) {
+  _initNumbers(DataType::Int16Array, values, count);
+}
+
+Data::Data(const int32_t* values, size_t count) {
+  _initNumbers(DataType::Int32Array, values, count);
+}
+
+Data::Data(const int64_t* values, size_t count) {
+  _initNumbers(DataType::Int64Array, values, count);
+}
+
+Data::Data(const uint8_t* values, size_t count) {
+  _initNumbers(DataType::UInt8Array, values, count);
+}
+
+Data::Data(const uint16_t* values, size_t count) {
+  _initNumbers(DataType::UInt16Array, values, count);
+}
+
+Data::Data(const uint32_t* values, size_t count) {
+  _initNumbers(DataType::UInt32Array, values, count);
+}
+
+Data::Data(const uint64_t* values, size_t count) {
+  _initNumbers(DataType::UInt64Array, values, count);
+}
+
+Data::Data(const bool* values, size_t count) {
+  // 要素数はシリアライズ後と同じくuint16_tで格納するため、一部を捨てずにNullにします。
+  if (count > MAX_SERIALIZED_LENGTH) {
+    _type = DataType::Null;
+    _data._null = nullptr;
+    return;
+  }
+  uint16_t len = count;
+  _type = DataType::BoolArray;
+  _data._bits = BytesBlock::create(nullptr, 2 + ((len + 7) >> 3));
+  uint8_t* bytes = reinterpret_cast<uint8_t*>(_data._bits->chars());
+  size_t off = 0;
+  serialize_int(bytes, off, len);
+  for (size_t i = 0; i < len; ++i)
+    if (values[i])
+      bytes[off + (i >> 3)] |= 1 << (i & 7);
+}
+
+Data::Data(const std::vector<Data>& array) {
+  _initArray(array.data(), array.size());
+}
+
+Data::Data(std::vector<Data>&& array) {
+  _type = DataType::Array;
+  _data._array = DataArray::_create(array.size());
+  Data* items = _data._array->_items();
+  for (size_t i = 0; i < array.size(); ++i)
+    items[i]._moveFrom(array[i]);
+}
+
+Data::Data(std::initializer_list<Data> array) {
+  _initArray(array.begin(), array.size());
+}
+
+Data::Data(const Data& other) {
+  _copyFrom(other);
+}
+
+Data::Data(Data&& other) noexcept {
+  _moveFrom(other);
+}
+
+Data::~Data() {
+  _release();
+}
+
+Data& Data::operator=(const Data& other) {
+  if (this != &other) {
+    _release();
+    _copyFrom(other);
+  }
   return *this;
 }
 
-Data& Data::operator=(Data&& other) {
-  if (_type == DataType::String)
-    delete _data._str;
-  else if (_type == DataType::Array)
-    delete _data._array;
-  _type = other._type;
-  if (other._type == DataType::String)
-    _data._str = new String(std::move(*other._data._str));
-  else if (other._type == DataType::Array)
-    _data._array = new std::vector<Data>(std::move(*other._data._array));
-  else
-    _data = other._data;
+Data& Data::operator=(Data&& other) noexcept {
+  if (this != &other) {
+    _release();
+    _moveFrom(other);
+  }
   return *this;
 }
 
+bool Data::set(size_t index, Data value) {
+  if (_type != DataType::Array || index >= _data._array->_size)
+    return false;
+  _data._array = _data._array->_unique();
+  _data._array->_items()[index] = std::move(value);
+  return true;
+}
+
 bool Data::operator==(const Data& other) const {
   bool b;
   if (other._type == _type)
@@ -86,10 +522,15 @@ bool Data::operator==(const Data& other) const {
         b = other._data._bool == _data._bool;
         break;
       case DataType::String:
-        b = *other._data._str == *_data._str;
+        b = other._length() == _length() && memcmp(other._chars(), _chars(), _length()) == 0;
         break;
       case DataType::Array:
-        b = *other._data._array == *_data._array;
+        {
+          const DataArray* array = _data._array;
+          const DataArray* other_array = other._data._array;
+          b = array == other_array
+              || std::equal(array->begin(), array->end(), other_array->begin(), other_array->end());
+        }
         break;
       case DataType::Int8:
         b = other._data._int8 == _data._int8;
@@ -115,6 +556,25 @@ bool Data::operator==(const Data& other) const {
       case DataType::UInt64:
         b = other._data._uint64 == _data._uint64;
         break;
+      case DataType::Float32:
+        b = other._data._float32 == _data._float32;
+        break;
+      case DataType::Float64:
+        b = other._data._float64 == _data._float64;
+        break;
+      case DataType::Int8Array:
+      case DataType::Int16Array:
+      case DataType::Int32Array:
+      case DataType::Int64Array:
+      case DataType::UInt8Array:
+      case DataType::UInt16Array:
+      case DataType::UInt32Array:
+      case DataType::UInt64Array:
+      case DataType::BoolArray:
+      case DataType::TimeSeries:
+        b = other._data._numbers->length == _data._numbers->length
+            && memcmp(other._data._numbers->chars(), _data._numbers->chars(), _data._numbers->length) == 0;
+        break;
       default:
         b = false;
         break;
@@ -124,44 +584,59 @@ bool Data::operator==(const Data& other) const {
   return b;
 }
 
+// 辞書のIDのビット列を操作します。
+static bool test_id(const uint32_t* ids, uint8_t id) noexcept {
+  return (ids[id >> 5] >> (id & 31) & 1) != 0;
+}
+static void set_id(uint32_t* ids, uint8_t id) noexcept {
+  ids[id >> 5] |= static_cast<uint32_t>(1) << (id & 31);
+}
+
+// 整数値をタグと可変長整数で書き込みます。
 template<class IntType>
-static void serialize_int(uint8_t* buf, size_t& off, IntType val) {
-  for (size_t i = 0; i < sizeof(IntType); ++i)
-    buf[off++] = (val >> (i << 3)) & 0xFF;
+static size_t serialize_compact(uint8_t* buf, size_t& off, size_t size, uint8_t tag, IntType val) {
+  uint64_t raw = zigzag_encode(val);
+  if (off + 1 + varint_size(raw) > size) return 0;
+  buf[off++] = tag;
+  serialize_varint(buf, off, raw);
+  return off;
 }
 
-size_t Data::_serialize(uint8_t* buf, size_t& off, size_t size) const {
+size_t Data::_serializeValue(uint8_t* buf, size_t& off, size_t size, const DataEncoding encoding, const DataDictionary* dict, uint32_t* sent) const {
   switch (_type) {
     case DataType::Null:
       if (off + 1 > size) return 0;
       buf[off++] = TYPE_NULL;
       break;
+    case DataType::Array:
+      // 配列は要素とともに_serializeで書き込みます。
+      return 0;
     case DataType::Bool:
       if (off + 1 > size) return 0;
       buf[off++] = _data._bool ? TYPE_TRUE : TYPE_FALSE;
       break;
     case DataType::String:
       {
-        const String& str = *_data._str;
-        uint16_t len = str.length();
-        if (off + 1 + 4 + len > size) return 0;
-        buf[off++] = TYPE_STRING;
-        serialize_int(buf, off, len);
-        for (uint16_t i = 0; i < len; ++i)
-          buf[off++] = str[i];
-      }
-      break;
-    case DataType::Array:
-      {
-        const std::vector<Data>& array = *_data._array;
-        uint16_t len = array.size();
-        if (off + 1 + 4 > size)
-          return 0;
-        buf[off++] = TYPE_ARRAY;
-        serialize_int(buf, off, len);
-        for (uint16_t i = 0; i < len; ++i)
-          if (array[i]._serialize(buf, off, size) == 0)
-            return 0;
+        size_t len = _length();
+        if (len > MAX_SERIALIZED_LENGTH) return 0;
+        int id = dict != nullptr ? dict->_find(_chars(), len) : -1;
+        if (id >= 0 && test_id(sent, id)) {
+          // 定義を書き込み済みの文字列はIDだけを書き込みます。
+          if (off + 1 + 1 > size) return 0;
+          buf[off++] = TYPE_STRING_REF;
+          buf[off++] = id;
+          break;
+        }
+        if (off + 1 + (id >= 0 ? 1 : 0) + 2 + len > size) return 0;
+        if (id >= 0) {
+          buf[off++] = TYPE_STRING_DEF;
+          buf[off++] = id;
+          set_id(sent, id);
+        } else
+          buf[off++] = TYPE_STRING;
+        serialize_int(buf, off, static_cast<uint16_t>(len));
+        memcpy(buf + off, _chars(), len);
+        off += len;
       }
       break;
     case DataType::Int8:
@@ -170,16 +645,22 @@ size_t Data::_serialize(uint8_t* buf, size_t& off, size_t size) const {
       serialize_int(buf, off, _data._int8);
       break;
     case DataType::Int16:
+      if (encoding == DataEncoding::Compact)
+        return serialize_compact(buf, off, size, TYPE_VAR_INT16, _data._int16);
       if (off + 1 + 2 > size) return 0;
       buf[off++] = TYPE_INT16;
       serialize_int(buf, off, _data._int16);
       break;
     case DataType::Int32:
+      if (encoding == DataEncoding::Compact)
+        return serialize_compact(buf, off, size, TYPE_VAR_INT32, _data._int32);
       if (off + 1 + 4 > size) return 0;
       buf[off++] = TYPE_INT32;
       serialize_int(buf, off, _data._int32);
       break;
     case DataType::Int64:
+      if (encoding == DataEncoding::Compact)
+        return serialize_compact(buf, off, size, TYPE_VAR_INT64, _data._int64);
       if (off + 1 + 8 > size) return 0;
       buf[off++] = TYPE_INT64;
       serialize_int(buf, off, _data._int64);
@@ -190,33 +671,364 @@ size_t Data::_serialize(uint8_t* buf, size_t& off, size_t size) const {
       serialize_int(buf, off, _data._uint8);
       break;
     case DataType::UInt16:
+      if (encoding == DataEncoding::Compact)
+        return serialize_compact(buf, off, size, TYPE_VAR_UINT16, _data._uint16);
       if (off + 1 + 2 > size) return 0;
       buf[off++] = TYPE_UINT16;
       serialize_int(buf, off, _data._uint16);
       break;
     case DataType::UInt32:
+      if (encoding == DataEncoding::Compact)
+        return serialize_compact(buf, off, size, TYPE_VAR_UINT32, _data._uint32);
       if (off + 1 + 4 > size) return 0;
       buf[off++] = TYPE_UINT32;
       serialize_int(buf, off, _data._uint32);
       break;
     case DataType::UInt64:
+      if (encoding == DataEncoding::Compact)
+        return serialize_compact(buf, off, size, TYPE_VAR_UINT64, _data._uint64);
       if (off + 1 + 8 > size) return 0;
       buf[off++] = TYPE_UINT64;
       serialize_int(buf, off, _data._uint64);
       break;
+    case DataType::Float32:
+      if (off + 1 + 4 > size) return 0;
+      buf[off++] = TYPE_FLOAT32;
+      serialize_float(buf, off, _data._float32);
+      break;
+    case DataType::Float64:
+      if (off + 1 + 8 > size) return 0;
+      buf[off++] = TYPE_FLOAT64;
+      serialize_float(buf, off, _data._float64);
+      break;
+    case DataType::Int8Array:
+    case DataType::Int16Array:
+    case DataType::Int32Array:
+    case DataType::Int64Array:
+    case DataType::UInt8Array:
+    case DataType::UInt16Array:
+    case DataType::UInt32Array:
+    case DataType::UInt64Array:
+      {
+        size_t len = _data._numbers->length;
+        if (len / element_size(_type) > MAX_SERIALIZED_LENGTH || off + 1 + 2 + len > size) return 0;
+        buf[off++] = array_tag(_type);
+        serialize_int(buf, off, static_cast<uint16_t>(len / element_size(_type)));
+        memcpy(buf + off, _data._numbers->chars(), len);
+        off += len;
+      }
+      break;
+    case DataType::BoolArray:
+    case DataType::TimeSeries:
+      // 要素数と値はシリアライズ後と同じ形で格納されています。
+      if (off + 1 + _data._bits->length > size) return 0;
+      buf[off++] = _isBits() ? TYPE_BOOL_ARRAY : TYPE_TIME_SERIES;
+      memcpy(buf + off, _data._bits->chars(), _data._bits->length);
+      off += _data._bits->length;
+      break;
   }
   return off;
 }
 
+size_t Data::_serialize(uint8_t* buf, size_t& off, size_t size, const DataEncoding encoding, const DataDictionary* dict, uint32_t* sent) const {
+  // 書き込み途中の配列の次の要素と残りの要素数
+  struct Frame {
+    const Data* next;
+    size_t rest;
+  };
+  Frame stack[DATA_MAX_DEPTH];
+  size_t depth = 0;
+  const Data* data = this;
+  for (;;) {
+    if (data->_type == DataType::Array) {
+      size_t len = data->_data._array->_size;
+      if (depth == DATA_MAX_DEPTH || len > MAX_SERIALIZED_LENGTH || off + 1 + 2 > size) return 0;
+      buf[off++] = TYPE_ARRAY;
+      serialize_int(buf, off, static_cast<uint16_t>(len));
+      stack[depth++] = Frame{ data->_data._array->begin(), len };
+    } else if (data->_serializeValue(buf, off, size, encoding, dict, sent) == 0)
+      return 0;
+    while (depth > 0 && stack[depth - 1].rest == 0)
+      --depth;
+    if (depth == 0)
+      return off;
+    --stack[depth - 1].rest;
+    data = stack[depth - 1].next++;
+  }
+}
+
+
+// 可変長整数で書き込まれた整数値を読み出します。
 template<class IntType>
-static IntType deserialize_int(const uint8_t* buf, size_t& off) {
-  IntType val = 0;
-  for (size_t i = 0; i < sizeof(IntType); ++i)
-    val |= static_cast<IntType>(buf[off++]) << (i << 3);
-  return val;
+static bool deserialize_compact(const uint8_t* buf, size_t& off, size_t size, IntType& val) {
+  uint64_t raw;
+  if (!deserialize_varint(buf, off, size, sizeof(IntType) << 3, raw)) return false;
+  val = zigzag_decode<IntType>(raw);
+  return true;
+}
+
+size_t Data::_valueSize(DataEncoding encoding, const DataDictionary* dict, uint32_t* sent) const noexcept {
+  switch (_type) {
+    case DataType::String:
+      {
+        size_t len = _length();
+        if (len > MAX_SERIALIZED_LENGTH)
+          return 0;
+        int id = dict != nullptr ? dict->_find(_chars(), len) : -1;
+        if (id < 0)
+          return 1 + 2 + len;
+        if (test_id(sent, id))
+          return 1 + 1;
+        set_id(sent, id);
+        return 1 + 1 + 2 + len;
+      }
+    case DataType::Int8:
+    case DataType::UInt8:
+      return 1 + 1;
+    case DataType::Int16:
+      return 1 + (encoding == DataEncoding::Compact ? varint_size(zigzag_encode(_data._int16)) : 2);
+    case DataType::Int32:
+      return 1 + (encoding == DataEncoding::Compact ? varint_size(zigzag_encode(_data._int32)) : 4);
+    case DataType::Int64:
+      return 1 + (encoding == DataEncoding::Compact ? varint_size(zigzag_encode(_data._int64)) : 8);
+    case DataType::UInt16:
+      return 1 + (encoding == DataEncoding::Compact ? varint_size(_data._uint16) : 2);
+    case DataType::UInt32:
+      return 1 + (encoding == DataEncoding::Compact ? varint_size(_data._uint32) : 4);
+    case DataType::UInt64:
+      return 1 + (encoding == DataEncoding::Compact ? varint_size(_data._uint64) : 8);
+    case DataType::Float32:
+      return 1 + 4;
+    case DataType::Float64:
+      return 1 + 8;
+    case DataType::Int8Array:
+    case DataType::Int16Array:
+    case DataType::Int32Array:
+    case DataType::Int64Array:
+    case DataType::UInt8Array:
+    case DataType::UInt16Array:
+    case DataType::UInt32Array:
+    case DataType::UInt64Array:
+      if (_data._numbers->length / element_size(_type) > MAX_SERIALIZED_LENGTH)
+        return 0;
+      return 1 + 2 + _data._numbers->length;
+    case DataType::BoolArray:
+    case DataType::TimeSeries:
+      return 1 + _data._bits->length;
+    default:
+      return 1;
+  }
+}
+
+size_t Data::serializedSize(DataEncoding encoding) const noexcept {
+  return _serializedSize(encoding, nullptr, nullptr);
+}
+
+size_t Data::serializedSize(DataEncoding encoding, const DataDictionary& dict) const noexcept {
+  // 同じメッセージ内で2回目以降に現れる文字列はIDだけになるため、定義を書き込むIDを複製して記録します。
+  uint32_t sent[sizeof(dict._sent) / sizeof(uint32_t)];
+  memcpy(sent, dict._sent, sizeof(sent));
+  return _serializedSize(encoding, &dict, sent);
+}
+
+size_t Data::_serializedSize(DataEncoding encoding, const DataDictionary* dict, uint32_t* sent) const noexcept {
+  struct Frame {
+    const Data* next;
+    size_t rest;
+  };
+  Frame stack[DATA_MAX_DEPTH];
+  size_t depth = 0;
+  size_t size = 0;
+  const Data* data = this;
+  for (;;) {
+    if (data->_type == DataType::Array) {
+      if (depth == DATA_MAX_DEPTH || data->_data._array->_size > MAX_SERIALIZED_LENGTH) return 0;
+      size += 1 + 2;
+      stack[depth++] = Frame{ data->_data._array->begin(), data->_data._array->_size };
+    } else {
+      // シリアライズできない値は0を返します。
+      size_t value_size = data->_valueSize(encoding, dict, sent);
+      if (value_size == 0) return 0;
+      size += value_size;
+    }
+    while (depth > 0 && stack[depth - 1].rest == 0)
+      --depth;
+    if (depth == 0)
+      return size;
+    --stack[depth - 1].rest;
+    data = stack[depth - 1].next++;
+  }
+}
+
+
+size_t Data::serialize(std::vector<uint8_t>& out, DataEncoding encoding) const {
+  size_t off = out.size();
+  size_t size = serializedSize(encoding);
+  if (size == 0)
+    return 0;
+  out.resize(off + size);
+  return _serialize(out.data(), off, out.size(), encoding);
+}
+
+size_t Data::_serializeWith(uint8_t* buf, size_t& off, const size_t size, const DataEncoding encoding, DataDictionary& dict) const {
+  // 書き込めなかった場合に辞書を変更しないように、複製したビット列に記録します。
+  uint32_t sent[sizeof(dict._sent) / sizeof(uint32_t)];
+  memcpy(sent, dict._sent, sizeof(sent));
+  if (_serialize(buf, off, size, encoding, &dict, sent) == 0)
+    return 0;
+  memcpy(dict._sent, sent, sizeof(sent));
+  dict._onMessage();
+  return off;
+}
+
+size_t Data::serialize(uint8_t* buf, size_t size, DataEncoding encoding, DataDictionary& dict) const {
+  size_t off = 0;
+  return _serializeWith(buf, off, size, encoding, dict);
+}
+
+size_t Data::serialize(std::vector<uint8_t>& out, DataEncoding encoding, DataDictionary& dict) const {
+  size_t off = out.size();
+  size_t size = serializedSize(encoding, dict);
+  if (size == 0)
+    return 0;
+  out.resize(off + size);
+  return _serializeWith(out.data(), off, out.size(), encoding, dict);
+}
+
+size_t Data::_measureValue(const uint8_t* buf, size_t& off, const size_t size, size_t& bytes, DataDictionary* dict, uint32_t* defined) {
+  if (off >= size) return 0;
+  size_t width;
+  switch (buf[off++]) {
+    case TYPE_NULL:
+    case TYPE_TRUE:
+    case TYPE_FALSE:
+      width = 0;
+      break;
+    case TYPE_STRING:
+      if (off + 2 > size) return 0;
+      {
+        uint16_t len = deserialize_int<uint16_t>(buf, off);
+        if (len > SMALL_STRING_CAPACITY)
+          bytes += Arena::align(BytesBlock::allocation_size(len));
+        width = len;
+      }
+      break;
+    case TYPE_STRING_DEF:
+      // 辞書の文字列は辞書の領域を共有するため、ここでは確保しません。
+      if (dict == nullptr || off + 1 + 2 > size) return 0;
+      set_id(defined, buf[off++]);
+      width = deserialize_int<uint16_t>(buf, off);
+      break;
+    case TYPE_STRING_REF:
+      if (dict == nullptr || off + 1 > size) return 0;
+      if (!test_id(defined, buf[off]) && !dict->_defined(buf[off])) {
+        ++dict->_misses;
+        return 0;
+      }
+      ++off;
+      width = 0;
+      break;
+    case TYPE_INT8:
+    case TYPE_UINT8:
+      width = 1;
+      break;
+    case TYPE_INT16:
+    case TYPE_UINT16:
+      width = 2;
+      break;
+    case TYPE_INT32:
+    case TYPE_UINT32:
+    case TYPE_FLOAT32:
+      width = 4;
+      break;
+    case TYPE_INT64:
+    case TYPE_UINT64:
+    case TYPE_FLOAT64:
+      width = 8;
+      break;
+    case TYPE_VAR_INT16:
+    case TYPE_VAR_UINT16:
+      {
+        uint16_t val;
+        if (!deserialize_compact(buf, off, size, val)) return 0;
+        width = 0;
+      }
+      break;
+    case TYPE_VAR_INT32:
+    case TYPE_VAR_UINT32:
+      {
+        uint32_t val;
+        if (!deserialize_compact(buf, off, size, val)) return 0;
+        width = 0;
+      }
+      break;
+    case TYPE_VAR_INT64:
+    case TYPE_VAR_UINT64:
+      {
+        uint64_t val;
+        if (!deserialize_compact(buf, off, size, val)) return 0;
+        width = 0;
+      }
+      break;
+    case TYPE_BOOL_ARRAY:
+      if (off + 2 > size) return 0;
+      width = (deserialize_int<uint16_t>(buf, off) + 7) >> 3;
+      bytes += Arena::align(BytesBlock::allocation_size(2 + width));
+      break;
+    case TYPE_TIME_SERIES:
+      if (off + 1 + 2 + 2 > size || buf[off] > static_cast<uint8_t>(TimeSeriesType::Int64)) return 0;
+      off += 1 + 2;
+      width = deserialize_int<uint16_t>(buf, off);
+      bytes += Arena::align(BytesBlock::allocation_size(1 + 2 + 2 + width));
+      break;
+    default:
+      {
+        DataType type = array_type(buf[off - 1]);
+        if (type == DataType::Null || off + 2 > size) return 0;
+        width = deserialize_int<uint16_t>(buf, off) * element_size(type);
+        bytes += Arena::align(BytesBlock::allocation_size(width));
+      }
+      break;
+  }
+  if (off + width > size) return 0;
+  off += width;
+  return off;
+}
+
+size_t Data::_measure(const uint8_t* buf, size_t& off, const size_t size, size_t& bytes, const DataLimits& limits, DataDictionary* dict) {
+  // 読み出し途中の配列の残りの要素数
+  size_t stack[DATA_MAX_DEPTH];
+  // このメッセージ内で定義された辞書のID
+  uint32_t defined[DataDictionary::MAX_ENTRIES / 32] = {};
+  size_t max_depth = std::min<size_t>(limits.max_depth, DATA_MAX_DEPTH);
+  size_t depth = 0;
+  size_t elements = 0;
+  for (;;) {
+    if (off >= size || ++elements > limits.max_elements) return 0;
+    if (buf[off] == TYPE_ARRAY) {
+      if (depth == max_depth || off + 1 + 2 > size) return 0;
+      ++off;
+      size_t len = deserialize_int<uint16_t>(buf, off);
+      bytes += Arena::align(DataArray::_allocationSize(len));
+      stack[depth++] = len;
+    } else {
+      uint8_t tag = buf[off];
+      if (_measureValue(buf, off, size, bytes, dict, defined) == 0)
+        return 0;
+      // 配列の要素が辞書の文字列を共有する場合は、領域に参照を記録します。
+      if (depth > 0 && (tag == TYPE_STRING_DEF || tag == TYPE_STRING_REF))
+        bytes += Arena::align(sizeof(Arena::Shared));
+    }
+    while (depth > 0 && stack[depth - 1] == 0)
+      --depth;
+    if (depth == 0)
+      return off;
+    --stack[depth - 1];
+  }
 }
 
-size_t Data::_deserialize(const uint8_t* buf, size_t& off, const size_t size, Data* const data_p) {
+
+size_t Data::_deserializeValue(const uint8_t* buf, size_t& off, const size_t size, Data* const data_p, Arena* const arena, DataDictionary* dict) {
   if (off >= size) return false;
   switch (buf[off++]) {
     case TYPE_NULL:
@@ -229,24 +1041,38 @@ size_t Data::_deserialize(const uint8_t* buf, size_t& off, const size_t size, Da
       *data_p = false;
       break;
     case TYPE_STRING:
-      if (off + 4 > size) return 0;
+      if (off + 2 > size) return 0;
       {
         uint16_t len = deserialize_int<uint16_t>(buf, off);
-        String str;
-        if (!str.reserve(len)) return false;
-        for (uint16_t i = 0; i < len; ++i)
-          str.concat(static_cast<char>(buf[off++]));
-        *data_p = str;
+        if (off + len > size) return 0;
+        const char* str = reinterpret_cast<const char*>(buf + off);
+        if (arena != nullptr && len > SMALL_STRING_CAPACITY)
+          data_p->_adopt(BytesBlock::create(str, len, arena));
+        else
+          *data_p = Data(str, len);
+        off += len;
       }
       break;
-    case TYPE_ARRAY:
-      if (off + 4 > size) return 0;
+    case TYPE_STRING_DEF:
+    case TYPE_STRING_REF:
       {
-        uint16_t len = deserialize_int<uint16_t>(buf, off);
-        std::vector<Data> array(len);
-        for (uint16_t i = 0; i < len; ++i)
-          if (_deserialize(buf, off, size, &array[i]) == 0) return 0;
-        *data_p = array;
+        bool def = buf[off - 1] == TYPE_STRING_DEF;
+        if (dict == nullptr || off + (def ? 1 + 2 : 1) > size) return 0;
+        uint8_t id = buf[off++];
+        if (def) {
+          uint16_t len = deserialize_int<uint16_t>(buf, off);
+          if (off + len > size) return 0;
+          dict->_define(id, Data(reinterpret_cast<const char*>(buf + off), len));
+          off += len;
+        } else if (!dict->_defined(id))
+          return 0;
+        const Data& entry = dict->_entries[id];
+        if (arena != nullptr && !entry._isSmall()) {
+          // 領域内のデータは参照をもたないため、参照は領域に持たせます。
+          arena->share(entry._data._str->retain());
+          data_p->_adopt(entry._data._str);
+        } else
+          *data_p = entry;
       }
       break;
     case TYPE_INT8:
@@ -281,22 +1107,267 @@ size_t Data::_deserialize(const uint8_t* buf, size_t& off, const size_t size, Da
       if (off + 8 > size) return 0;
       *data_p = deserialize_int<uint64_t>(buf, off);
       break;
+    case TYPE_FLOAT32:
+      if (off + 4 > size) return 0;
+      *data_p = deserialize_float<float>(buf, off);
+      break;
+    case TYPE_FLOAT64:
+      if (off + 8 > size) return 0;
+      *data_p = deserialize_float<double>(buf, off);
+      break;
+    case TYPE_VAR_INT16:
+      {
+        int16_t val;
+        if (!deserialize_compact(buf, off, size, val)) return 0;
+        *data_p = val;
+      }
+      break;
+    case TYPE_VAR_INT32:
+      {
+        int32_t val;
+        if (!deserialize_compact(buf, off, size, val)) return 0;
+        *data_p = val;
+      }
+      break;
+    case TYPE_VAR_INT64:
+      {
+        int64_t val;
+        if (!deserialize_compact(buf, off, size, val)) return 0;
+        *data_p = val;
+      }
+      break;
+    case TYPE_VAR_UINT16:
+      {
+        uint16_t val;
+        if (!deserialize_compact(buf, off, size, val)) return 0;
+        *data_p = val;
+      }
+      break;
+    case TYPE_VAR_UINT32:
+      {
+        uint32_t val;
+        if (!deserialize_compact(buf, off, size, val)) return 0;
+        *data_p = val;
+      }
+      break;
+    case TYPE_VAR_UINT64:
+      {
+        uint64_t val;
+        if (!deserialize_compact(buf, off, size, val)) return 0;
+        *data_p = val;
+      }
+      break;
+    case TYPE_BOOL_ARRAY:
+      if (off + 2 > size) return 0;
+      {
+        uint16_t count = deserialize_int<uint16_t>(buf, off);
+        size_t len = 2 + ((count + 7) >> 3);
+        if (off - 2 + len > size) return 0;
+        BytesBlock* bits = BytesBlock::create(buf + off - 2, len, arena);
+        // 要素数を超える部分のビットは0にそろえます。
+        if ((count & 7) != 0)
+          bits->chars()[len - 1] &= (1 << (count & 7)) - 1;
+        data_p->_adopt(bits, DataType::BoolArray);
+        off += len - 2;
+      }
+      break;
+    case TYPE_TIME_SERIES:
+      if (off + 1 + 2 + 2 > size || buf[off] > static_cast<uint8_t>(TimeSeriesType::Int64)) return 0;
+      {
+        size_t pos = off + 1 + 2;
+        size_t len = 1 + 2 + 2 + deserialize_int<uint16_t>(buf, pos);
+        if (off + len > size) return 0;
+        data_p->_adopt(BytesBlock::create(buf + off, len, arena), DataType::TimeSeries);
+        off += len;
+      }
+      break;
     default:
-      return 0;
+      {
+        DataType type = array_type(buf[off - 1]);
+        if (type == DataType::Null || off + 2 > size) return 0;
+        size_t len = deserialize_int<uint16_t>(buf, off) * element_size(type);
+        if (off + len > size) return 0;
+        data_p->_adopt(BytesBlock::create(buf + off, len, arena), type);
+        off += len;
+      }
+      break;
   }
   return off;
 }
 
+size_t Data::_deserialize(const uint8_t* buf, size_t& off, const size_t size, Data* const data_p, const DataLimits& limits, Arena* const arena, DataDictionary* dict) {
+  // 読み出し途中の配列の次の要素と残りの要素数
+  struct Frame {
+    Data* next;
+    size_t rest;
+  };
+  Frame stack[DATA_MAX_DEPTH];
+  size_t max_depth = std::min<size_t>(limits.max_depth, DATA_MAX_DEPTH);
+  size_t depth = 0;
+  size_t elements = 0;
+  Data result;
+  Data* data = &result;
+  for (;;) {
+    if (off >= size || ++elements > limits.max_elements)
+      break;
+    if (buf[off] == TYPE_ARRAY) {
+      if (depth == max_depth || off + 1 + 2 > size)
+        break;
+      ++off;
+      size_t len = deserialize_int<uint16_t>(buf, off);
+      // 要素は少なくとも1バイトずつあるため、残りのバイト数より多い要素数は正しくありません。
+      if (len > size - off)
+        break;
+      DataArray* array = DataArray::_create(len, arena);
+      data->_adopt(array);
+      stack[depth++] = Frame{ array->_items(), len };
+    } else if (_deserializeValue(buf, off, size, data, arena, dict) == 0)
+      break;
+    while (depth > 0 && stack[depth - 1].rest == 0)
+      --depth;
+    if (depth == 0) {
+      *data_p = std::move(result);
+      return off;
+    }
+    --stack[depth - 1].rest;
+    data = stack[depth - 1].next++;
+  }
+  // 領域内のデータは参照をもたないため、領域は呼び出し元で解放します。
+  if (arena != nullptr)
+    result._type = DataType::Null;
+  return 0;
+}
+
+
+bool Data::deserialize(const uint8_t* buf, const size_t size, Data* const data_p, const DataLimits& limits) {
+  return _deserializeWith(buf, size, data_p, limits, nullptr);
+}
+
+bool Data::deserialize(const uint8_t* buf, const size_t size, Data* const data_p, DataDictionary& dict, const DataLimits& limits) {
+  return _deserializeWith(buf, size, data_p, limits, &dict);
+}
+
+bool Data::_deserializeWith(const uint8_t* buf, const size_t size, Data* const data_p, const DataLimits& limits, DataDictionary* dict) {
+  size_t off = 0;
+  size_t bytes = 0;
+  if (size == 0 || _measure(buf, off, size, bytes, limits, dict) != size)
+    return false;
+  off = 0;
+  if (bytes == 0)
+    return _deserialize(buf, off, size, data_p, limits, nullptr, dict) == size;
+  /*
+    検査で求めたバイト数の領域を一度だけ確保します。
+    data_pの領域に十分な大きさがあり、他に参照がなければ確保せずに再利用します。
+  */
+  Arena* arena = data_p->_rootArena();
+  if (arena != nullptr && arena->capacity >= bytes && arena->refs.load(std::memory_order_acquire) == 1) {
+    // 古い値を解放してから領域を空にするため、参照を一つ残しておきます。
+    arena->retain();
+    *data_p = nullptr;
+    arena->reset();
+  } else
+    arena = Arena::create(bytes);
+  Data data;
+  if (_deserialize(buf, off, size, &data, limits, arena, dict) != size) {
+    arena->release();
+    return false;
+  }
+  // 最上位のデータが領域の最初の参照を引き継ぎます。
+  *data_p = std::move(data);
+  return true;
+}
+
+const DataArray& Data::asArray() const noexcept {
+  static const DataArray empty;
+  return _type == DataType::Array ? *_data._array : empty;
+}
+
+const Data& Data::at(size_t index) const noexcept {
+  return asArray().at(index);
+}
+
+DataBits Data::asBits() const noexcept {
+  if (!_isBits())
+    return DataBits();
+  return DataBits(reinterpret_cast<const uint8_t*>(_data._bits->chars()) + 2, size());
+}
+
+const char* Data::asString() const noexcept {
+  return _type == DataType::String ? _chars() : "";
+}
+
 Data::operator bool() const noexcept {
   return _type == DataType::Bool ? _data._bool : false;
 }
 
 Data::operator String() const {
-  return _type == DataType::String ? *_data._str : String();
+  if (_type != DataType::String)
+    return String();
+  return String(_chars(), _length());
 }
 
 Data::operator std::vector<Data>() const {
-  return _type == DataType::Array ? *_data._array : std::vector<Data>();
+  if (_type != DataType::Array)
+    return std::vector<Data>();
+  return std::vector<Data>(_data._array->begin(), _data._array->end());
+}
+
+size_t Data::size() const noexcept {
+  if (_type == DataType::String)
+    return _length();
+  if (_type == DataType::Array)
+    return _data._array->_size;
+  if (_isNumbers())
+    return _data._numbers->length / element_size(_type);
+  if (_isBits()) {
+    size_t off = 0;
+    return deserialize_int<uint16_t>(reinterpret_cast<const uint8_t*>(_data._bits->chars()), off);
+  }
+  if (_isSeries()) {
+    size_t off = 1;
+    return deserialize_int<uint16_t>(reinterpret_cast<const uint8_t*>(_data._numbers->chars()), off);
+  }
+  return 0;
+}
+
+Data::operator std::vector<bool>() const {
+  DataBits bits = asBits();
+  std::vector<bool> values(bits.size());
+  for (size_t i = 0; i < bits.size(); ++i)
+    values[i] = bits[i];
+  return values;
+}
+
+Data::operator std::vector<int8_t>() const {
+  return _toVector<int8_t>();
+}
+
+Data::operator std::vector<int16_t>() const {
+  return _toVector<int16_t>();
+}
+
+Data::operator std::vector<int32_t>() const {
+  return _toVector<int32_t>();
+}
+
+Data::operator std::vector<int64_t>() const {
+  return _toVector<int64_t>();
+}
+
+Data::operator std::vector<uint8_t>() const {
+  return _toVector<uint8_t>();
+}
+
+Data::operator std::vector<uint16_t>() const {
+  return _toVector<uint16_t>();
+}
+
+Data::operator std::vector<uint32_t>() const {
+  return _toVector<uint32_t>();
+}
+
+Data::operator std::vector<uint64_t>() const {
+  return _toVector<uint64_t>();
 }
 
 Data::operator int8_t() const noexcept {
@@ -329,4 +1400,12 @@ Data::operator uint32_t() const noexcept {
 
 Data::operator uint64_t() const noexcept {
   return _type == DataType::UInt64 ? _data._uint64 : static_cast<uint64_t>(0xFFFFFFFFFFFFFFFF);
+}
+
+Data::operator float() const noexcept {
+  return _type == DataType::Float32 ? _data._float32 : NAN;
+}
+
+Data::operator double() const noexcept {
+  return _type == DataType::Float64 ? _data._float64 : NAN;
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 
 #include <Esp.h>
 
+#include <atomic>
 #include <initializer_list>
 #include <vector>
 
@@ -23,7 +24,23 @@ enum class DataType : uint8_t {
   UInt8,   // uint8_t型
   UInt16,  // uint16_t型
   UInt32,  // uint32_t型
-  UInt64   // uint64_t型
+  UInt64,  // uint64_t型
+
+  Int8Array,    // int8_t型の数値配列
+  Int16Array,   // int16_t型の数値配列
+  Int32Array,   // int32_t型の数値配列
+  Int64Array,   // int64_t型の数値配列
+  UInt8Array,   // uint8_t型の数値配列
+  UInt16Array,  // uint16_t型の数値配列
+  UInt32Array,  // uint32_t型の数値配列
+  UInt64Array,  // uint64_t型の数値配列
+
+  Float32,  // float型
+  Float64,  // double型
+
+  BoolArray,  // bool型の配列（1バイトに8個ずつ格納）
+
+  TimeSeries  // 時系列（TimeSeriesEncoderで圧縮した時刻と値の組の列）
 };
 
 static const constexpr uint8_t TYPE_NULL = 0;
@@ -39,20 +56,104 @@ static const constexpr uint8_t TYPE_UINT8 = 9;
 static const constexpr uint8_t TYPE_UINT16 = 10;
 static const constexpr uint8_t TYPE_UINT32 = 11;
 static const constexpr uint8_t TYPE_UINT64 = 12;
+static const constexpr uint8_t TYPE_INT8_ARRAY = 13;
+static const constexpr uint8_t TYPE_INT16_ARRAY = 14;
+static const constexpr uint8_t TYPE_INT32_ARRAY = 15;
+static const constexpr uint8_t TYPE_INT64_ARRAY = 16;
+static const constexpr uint8_t TYPE_UINT8_ARRAY = 17;
+static const constexpr uint8_t TYPE_UINT16_ARRAY = 18;
+static const constexpr uint8_t TYPE_UINT32_ARRAY = 19;
+static const constexpr uint8_t TYPE_UINT64_ARRAY = 20;
+static const constexpr uint8_t TYPE_FLOAT32 = 21;
+static const constexpr uint8_t TYPE_FLOAT64 = 22;
+static const constexpr uint8_t TYPE_VAR_INT16 = 23;
+static const constexpr uint8_t TYPE_VAR_INT32 = 24;
+static const constexpr uint8_t TYPE_VAR_INT64 = 25;
+static const constexpr uint8_t TYPE_VAR_UINT16 = 26;
+static const constexpr uint8_t TYPE_VAR_UINT32 = 27;
+static const constexpr uint8_t TYPE_VAR_UINT64 = 28;
+static const constexpr uint8_t TYPE_BOOL_ARRAY = 29;
+static const constexpr uint8_t TYPE_TIME_SERIES = 30;
+static const constexpr uint8_t TYPE_STRING_DEF = 31;  // 辞書の文字列の定義（ID、長さ、文字列）
+static const constexpr uint8_t TYPE_STRING_REF = 32;  // 辞書の文字列のID
+
+/*
+  シリアライズ時の整数の表現を表す列挙型
+*/
+enum class DataEncoding : uint8_t {
+  Fixed,   // 型の幅のまま書き込みます
+  Compact  // 16bit以上の整数を可変長整数（符号付きはZigZag符号化）で書き込みます
+};
+
+/*
+  時系列の値の型を表す列挙型
+*/
+enum class TimeSeriesType : uint8_t {
+  Float32,  // float型（前の値とのXORで圧縮します）
+  Float64,  // double型（前の値とのXORで圧縮します）
+  Int64     // 整数型（前の値との差で圧縮します）
+};
+
+#ifndef DATA_MAX_DEPTH
+// 配列の入れ子の最大数（シリアライズとデシリアライズで使用するスタックの大きさ）
+#define DATA_MAX_DEPTH 16
+#endif
+
+#ifndef DATA_MAX_ELEMENTS
+// 一つのメッセージに含めることができるデータ数の既定値
+#define DATA_MAX_ELEMENTS 4096
+#endif
+
+/*
+  デシリアライズするデータの制限
+  制限を超えるデータは正しくないデータとして扱います。
+*/
+struct DataLimits {
+  uint8_t max_depth = DATA_MAX_DEPTH;        // 配列の入れ子の最大数（DATA_MAX_DEPTHを超える値はDATA_MAX_DEPTHとして扱います）
+  size_t max_elements = DATA_MAX_ELEMENTS;  // 配列の要素を含むデータの最大数
+};
 
 class DataArray;
+class DataBits;
+class TimeSeriesEncoder;
+class TimeSeriesDecoder;
+class DataDictionary;
 
 /*
   データ型と値をもつクラスです。
 */
 class Data {
 private:
+  friend class DataArray;
+  friend class TimeSeriesEncoder;
+  friend class TimeSeriesDecoder;
+  friend class DataDictionary;
+
+  // 内部に直接格納できる文字列の最大長（終端文字を除く）
+  static const constexpr uint8_t SMALL_STRING_CAPACITY = 13;
+  // 短い文字列を格納する領域の先頭位置（_small_lenの直後）
+  static const constexpr size_t SMALL_STRING_OFFSET = 2;
+  // 文字列がヒープ上にあることを表す_small_lenの値
+  static const constexpr uint8_t LARGE_STRING = 0xFF;
+
+  // 文字列型と数値配列型の値を共有するための参照カウント付きブロック
+  struct BytesBlock;
+  // 一つのメッセージの文字列と配列をまとめて格納する領域
+  struct Arena;
+
   DataType _type;
+  /*
+    短い文字列の長さ
+    短い文字列はこの直後のパディングと_dataの領域に終端文字を含めて格納されます。
+  */
+  uint8_t _small_len = LARGE_STRING;
   union {
     std::nullptr_t _null;
     bool _bool;
-    String* _str;
-    std::vector<Data>* _array;
+    BytesBlock* _str;
+    BytesBlock* _numbers;
+    BytesBlock* _bits;
+    DataArray* _array;
     int8_t _int8;
     int16_t _int16;
     int32_t _int32;
@@ -62,10 +163,138 @@ private:
     uint16_t _uint16;
     uint32_t _uint32;
     uint64_t _uint64;
+
+    float _float32;
+    double _float64;
   } _data;
 
-  size_t _serialize(uint8_t* /* buf */, size_t& /* off */, const size_t /* size */) const;
-  static size_t _deserialize(const uint8_t* /* buf */, size_t& /* off */, const size_t /* size */, Data* const /* data_p */);
+  char* _small() noexcept {
+    return reinterpret_cast<char*>(this) + SMALL_STRING_OFFSET;
+  }
+  const char* _small() const noexcept {
+    return reinterpret_cast<const char*>(this) + SMALL_STRING_OFFSET;
+  }
+  bool _isSmall() const noexcept {
+    return _type == DataType::String && _small_len != LARGE_STRING;
+  }
+  bool _isNumbers() const noexcept {
+    return _type >= DataType::Int8Array && _type <= DataType::UInt64Array;
+  }
+  /*
+    bool型の配列の値は、要素数（uint16_t）と1バイトに8個ずつ詰めた値をシリアライズ後と同じ形でBytesBlockに格納します。
+  */
+  bool _isBits() const noexcept {
+    return _type == DataType::BoolArray;
+  }
+  /*
+    時系列の値は、値の型（uint8_t）、要素数（uint16_t）、圧縮したバイト数（uint16_t）と圧縮したバイト列をシリアライズ後と同じ形でBytesBlockに格納します。
+  */
+  bool _isSeries() const noexcept {
+    return _type == DataType::TimeSeries;
+  }
+  // シリアライズ後と同じ形でBytesBlockに格納するデータ型であればtrueを返します。
+  bool _isEncoded() const noexcept {
+    return _isBits() || _isSeries();
+  }
+  static constexpr DataType _arrayType(int8_t) {
+    return DataType::Int8Array;
+  }
+  static constexpr DataType _arrayType(int16_t) {
+    return DataType::Int16Array;
+  }
+  static constexpr DataType _arrayType(int32_t) {
+    return DataType::Int32Array;
+  }
+  static constexpr DataType _arrayType(int64_t) {
+    return DataType::Int64Array;
+  }
+  static constexpr DataType _arrayType(uint8_t) {
+    return DataType::UInt8Array;
+  }
+  static constexpr DataType _arrayType(uint16_t) {
+    return DataType::UInt16Array;
+  }
+  static constexpr DataType _arrayType(uint32_t) {
+    return DataType::UInt32Array;
+  }
+  static constexpr DataType _arrayType(uint64_t) {
+    return DataType::UInt64Array;
+  }
+  void _initNumbers(DataType /* type */, const void* /* values */, size_t /* count */);
+  void _initEncoded(DataType /* type */, const void* /* bytes */, size_t /* len */);
+  const uint8_t* _encoded(DataType /* type */, size_t& /* len */) const noexcept;
+  const void* _values(DataType /* type */) const noexcept;
+  template<class T>
+  std::vector<T> _toVector() const;
+  void _initString(const char* /* str */, size_t /* len */);
+  void _initArray(const Data* /* items */, size_t /* size */);
+  void _release() noexcept;
+  // 値を格納している領域（領域内に確保されていない場合はnullptr）
+  Arena* _rootArena() const noexcept;
+  void _copyFrom(const Data&);
+  void _moveFrom(Data&) noexcept;
+  void _adopt(BytesBlock* /* bytes */, DataType /* type */ = DataType::String) noexcept;
+  void _adopt(DataArray*) noexcept;
+  const char* _chars() const noexcept;
+  size_t _length() const noexcept;
+  const bool* _tryGet(const bool*) const noexcept {
+    return _type == DataType::Bool ? &_data._bool : nullptr;
+  }
+  const int8_t* _tryGet(const int8_t*) const noexcept {
+    return _type == DataType::Int8 ? &_data._int8 : nullptr;
+  }
+  const int16_t* _tryGet(const int16_t*) const noexcept {
+    return _type == DataType::Int16 ? &_data._int16 : nullptr;
+  }
+  const int32_t* _tryGet(const int32_t*) const noexcept {
+    return _type == DataType::Int32 ? &_data._int32 : nullptr;
+  }
+  const int64_t* _tryGet(const int64_t*) const noexcept {
+    return _type == DataType::Int64 ? &_data._int64 : nullptr;
+  }
+  const uint8_t* _tryGet(const uint8_t*) const noexcept {
+    return _type == DataType::UInt8 ? &_data._uint8 : nullptr;
+  }
+  const uint16_t* _tryGet(const uint16_t*) const noexcept {
+    return _type == DataType::UInt16 ? &_data._uint16 : nullptr;
+  }
+  const uint32_t* _tryGet(const uint32_t*) const noexcept {
+    return _type == DataType::UInt32 ? &_data._uint32 : nullptr;
+  }
+  const uint64_t* _tryGet(const uint64_t*) const noexcept {
+    return _type == DataType::UInt64 ? &_data._uint64 : nullptr;
+  }
+  const float* _tryGet(const float*) const noexcept {
+    return _type == DataType::Float32 ? &_data._float32 : nullptr;
+  }
+  const double* _tryGet(const double*) const noexcept {
+    return _type == DataType::Float64 ? &_data._float64 : nullptr;
+  }
+  const DataArray* _tryGet(const DataArray*) const noexcept {
+    return _type == DataType::Array ? _data._array : nullptr;
+  }
+  const char* _tryGet(const char*) const noexcept {
+    return _type == DataType::String ? _chars() : nullptr;
+  }
+
+  /*
+    配列の入れ子は再帰呼び出しではなく、DATA_MAX_DEPTHの大きさの明示的なスタックで処理します。
+    そのため受信タスクのような小さなスタックでも、入れ子の深いデータでスタックがあふれることはありません。
+  */
+  /*
+    dictにはDataDictionaryを、sentには定義を書き込んだIDのビット列を指定します。
+    sentは書き込んだ定義に合わせて更新されます。
+  */
+  size_t _serializeValue(uint8_t* /* buf */, size_t& /* off */, const size_t /* size */, const DataEncoding /* encoding */, const DataDictionary* /* dict */ = nullptr, uint32_t* /* sent */ = nullptr) const;
+  size_t _serialize(uint8_t* /* buf */, size_t& /* off */, const size_t /* size */, const DataEncoding /* encoding */, const DataDictionary* /* dict */ = nullptr, uint32_t* /* sent */ = nullptr) const;
+  size_t _valueSize(DataEncoding /* encoding */, const DataDictionary* /* dict */ = nullptr, uint32_t* /* sent */ = nullptr) const noexcept;
+  size_t _serializedSize(DataEncoding /* encoding */, const DataDictionary* /* dict */, uint32_t* /* sent */) const noexcept;
+  size_t _serializeWith(uint8_t* /* buf */, size_t& /* off */, const size_t /* size */, const DataEncoding /* encoding */, DataDictionary& /* dict */) const;
+  static size_t _measureValue(const uint8_t* /* buf */, size_t& /* off */, const size_t /* size */, size_t& /* bytes */, DataDictionary* /* dict */, uint32_t* /* defined */);
+  static size_t _measure(const uint8_t* /* buf */, size_t& /* off */, const size_t /* size */, size_t& /* bytes */, const DataLimits& /* limits */, DataDictionary* /* dict */ = nullptr);
+  static size_t _deserializeValue(const uint8_t* /* buf */, size_t& /* off */, const size_t /* size */, Data* const /* data_p */, Arena* const /* arena */, DataDictionary* /* dict */);
+  static size_t _deserialize(const uint8_t* /* buf */, size_t& /* off */, const size_t /* size */, Data* const /* data_p */, const DataLimits& /* limits */, Arena* const /* arena */ = nullptr, DataDictionary* /* dict */ = nullptr);
+  static bool _deserializeWith(const uint8_t* /* buf */, const size_t /* size */, Data* const /* data_p */, const DataLimits& /* limits */, DataDictionary* /* dict */);
 public:
   /*
     Nullを表すデータを構築します。
@@ -89,13 +318,22 @@ public:
   */
   Data(const char*);
 
+  /*
+    長さを指定して文字列型の値をもつデータを構築します。
+    文字列に終端文字が含まれていても構いません。
+  */
+  Data(const char* /* str */, size_t /* len */);
+
   /*
     配列型の値を持つデータを構築します。
+    要素の長い文字列や入れ子の配列は、配列とともに一つの連続した領域に複製されます。
   */
   Data(const std::vector<Data>&);
 
   /*
     配列型の値を持つデータを構築します。
+    要素は複製せずに配列へ移動し、長い文字列や入れ子の配列は元の領域を参照カウントで共有したまま引き継ぎます。
+    移動元の要素はNullになります。
   */
   Data(std::vector<Data>&&);
 
@@ -104,6 +342,53 @@ public:
   */
   Data(std::initializer_list<Data>);
 
+  /*
+    int8_t型の数値配列の値を持つデータを構築します。
+  */
+  Data(const int8_t* /* values */, size_t /* count */);
+
+  /*
+    int16_t型の数値配列の値を持つデータを構築します。
+  */
+  Data(const int16_t* /* values */, size_t /* count */);
+
+  /*
+    int32_t型の数値配列の値を持つデータを構築します。
+  */
+  Data(const int32_t* /* values */, size_t /* count */);
+
+  /*
+    int64_t型の数値配列の値を持つデータを構築します。
+  */
+  Data(const int64_t* /* values */, size_t /* count */);
+
+  /*
+    uint8_t型の数値配列の値を持つデータを構築します。
+  */
+  Data(const uint8_t* /* values */, size_t /* count */);
+
+  /*
+    uint16_t型の数値配列の値を持つデータを構築します。
+  */
+  Data(const uint16_t* /* values */, size_t /* count */);
+
+  /*
+    uint32_t型の数値配列の値を持つデータを構築します。
+  */
+  Data(const uint32_t* /* values */, size_t /* count */);
+
+  /*
+    uint64_t型の数値配列の値を持つデータを構築します。
+  */
+  Data(const uint64_t* /* values */, size_t /* count */);
+
+  /*
+    bool型の配列の値を持つデータを構築します。
+    値は1バイトに8個ずつ詰めて格納されます。
+    要素数は65535までで、超える場合は一部を捨てずにNullを表すデータを構築します。
+  */
+  Data(const bool* /* values */, size_t /* count */);
+
   /*
     bool型の値を持つデータを構築します。
   */
@@ -158,17 +443,31 @@ public:
   constexpr Data(uint64_t i) noexcept
     : _type(DataType::UInt64), _data{ ._uint64 = i } {}
 
+  /*
+    float型の値を持つデータを構築します。
+  */
+  constexpr Data(float f) noexcept
+    : _type(DataType::Float32), _data{ ._float32 = f } {}
+
+  /*
+    double型の値を持つデータを構築します。
+  */
+  constexpr Data(double f) noexcept
+    : _type(DataType::Float64), _data{ ._float64 = f } {}
+
   /*
     コピーコンストラクタ
     データを複製します。
+    文字列型と配列型の値は複製せずに共有します。
   */
   Data(const Data&);
 
   /*
     ムーブコンストラクタ
     データを移動します。
+    移動元のデータはNullになります。
   */
-  Data(Data&&);
+  Data(Data&&) noexcept;
 
   /*
     デストラクタ
@@ -178,36 +477,95 @@ public:
 
   /*
     データをコピー代入します。
+    文字列型と配列型の値は複製せずに共有します。
   */
   Data& operator=(const Data&);
 
   /*
     データをムーブ代入します。
+    移動元のデータはNullになります。
   */
-  Data& operator=(Data&&);
+  Data& operator=(Data&&) noexcept;
+
+  /*
+    配列型の値の要素を設定します。
+    値が他のデータと共有されている場合は、配列を複製してから変更します。
+    データが配列型でない場合や添字が範囲外の場合はfalseを返します。
+  */
+  bool set(size_t /* index */, Data /* value */);
+
+  /*
+    シリアライズしたときのバイト数を、バッファに書き込まずに求めます。
+    配列の入れ子がDATA_MAX_DEPTHを超える場合や、文字列の長さや配列の要素数が65535を超える場合は、シリアライズできないため0を返します。
+  */
+  size_t serializedSize(DataEncoding /* encoding */ = DataEncoding::Fixed) const noexcept;
 
   /*
     データをシリアライズします。
+    encodingにDataEncoding::Compactを指定すると、16bit以上の整数を値の大きさに応じた長さで書き込みます。
+    バッファが足りない場合や、serializedSizeが0になるデータの場合は0を返します。
   */
-  size_t serialize(uint8_t* buf, size_t off, size_t size) const {
-    return _serialize(buf, off, size);
+  size_t serialize(uint8_t* buf, size_t off, size_t size, DataEncoding encoding = DataEncoding::Fixed) const {
+    return _serialize(buf, off, size, encoding);
   }
 
   /*
     データをシリアライズします。
   */
-  size_t serialize(uint8_t* buf, size_t size) const {
-    return serialize(buf, 0, size);
+  size_t serialize(uint8_t* buf, size_t size, DataEncoding encoding = DataEncoding::Fixed) const {
+    return serialize(buf, 0, size, encoding);
   }
 
+  /*
+    データをシリアライズしてバッファの末尾に追加します。
+    バッファは必要なバイト数だけ拡張され、追加後のバイト数を返します。
+    シリアライズできない場合は0を返し、バッファは変更しません。
+  */
+  size_t serialize(std::vector<uint8_t>& /* out */, DataEncoding /* encoding */ = DataEncoding::Fixed) const;
+
+  /*
+    辞書を使用してシリアライズしたときのバイト数を求めます。
+    辞書は変更しません。
+  */
+  size_t serializedSize(DataEncoding /* encoding */, const DataDictionary& /* dict */) const noexcept;
+
+  /*
+    辞書に登録された文字列をIDで書き込みながらシリアライズします。
+    まだ定義を書き込んでいない文字列は定義を書き込み、辞書に書き込んだことを記録します。
+    バッファが足りない場合は0を返し、辞書は変更しません。
+  */
+  size_t serialize(uint8_t* /* buf */, size_t /* size */, DataEncoding /* encoding */, DataDictionary& /* dict */) const;
+
+  /*
+    辞書を使用してシリアライズし、バッファの末尾に追加します。
+  */
+  size_t serialize(std::vector<uint8_t>& /* out */, DataEncoding /* encoding */, DataDictionary& /* dict */) const;
+
+  /*
+    データをデシリアライズします。
+    データが正しくない場合や、入れ子の深さやデータ数がlimitsを超える場合はfalseを返します。
+    はじめにバッファ全体の構造を検査してからメモリを確保するため、正しくないデータではメモリの確保は行われません。
+    文字列と配列はすべて一つの連続した領域に確保するため、メモリの確保は一回で済みます。
+    領域はデシリアライズしたデータとその一部を参照するデータがすべて解放されたときにまとめて解放されます。
+    data_pが以前にデシリアライズしたデータで、その領域を他のデータが参照していなければ、領域を再利用してメモリの確保を省きます。
+  */
+  static bool deserialize(const uint8_t* /* buf */, const size_t /* size */, Data* const /* data_p */, const DataLimits& /* limits */ = DataLimits());
+
   /*
     データをデシリアライズします。
+    deserializeと同じです。
   */
-  static bool deserialize(const uint8_t* buf, const size_t size, Data* const data_p) {
-    size_t off = 0;
-    return _deserialize(buf, off, size, data_p) == size;
+  static bool deserializeInArena(const uint8_t* buf, const size_t size, Data* const data_p, const DataLimits& limits = DataLimits()) {
+    return deserialize(buf, size, data_p, limits);
   }
 
+  /*
+    辞書を使用してシリアライズされたデータをデシリアライズします。
+    定義は辞書に登録され、IDは辞書の文字列を共有したデータになります。
+    未定義のIDを含む場合はfalseを返し、辞書のmisses関数で取得できる数に加えます。
+  */
+  static bool deserialize(const uint8_t* /* buf */, const size_t /* size */, Data* const /* data_p */, DataDictionary& /* dict */, const DataLimits& /* limits */ = DataLimits());
+
   /*
     データ型と値が共に等しければtrue、そうでなければfalseを返します。
     データ型が異なる場合、値が同じでもfalseを返します。
@@ -229,6 +587,57 @@ public:
     return _type;
   }
 
+  /*
+    文字列型の長さ、配列型、数値配列型、bool型の配列または時系列の要素数を取得します。
+    それ以外のデータ型の場合は0を返します。
+  */
+  size_t size() const noexcept;
+
+  /*
+    数値配列型の値の先頭を取得します。
+    要素は連続して格納されており、要素数はsize関数で取得できます。
+    データ型が要素の型と一致しない場合はnullptrを返します。
+  */
+  template<class T>
+  const T* values() const noexcept {
+    return static_cast<const T*>(_values(_arrayType(T())));
+  }
+
+  /*
+    配列型の値を複製せずに参照します。
+    データが配列型でない場合は空の配列を返します。
+  */
+  const DataArray& asArray() const noexcept;
+
+  /*
+    配列型の値の要素を複製せずに参照します。
+    データが配列型でない場合や添字が範囲外の場合はNull型のデータを返します。
+  */
+  const Data& at(size_t /* index */) const noexcept;
+
+  /*
+    bool型の配列の値を複製せずに参照します。
+    データがbool型の配列でない場合は空の配列を返します。
+  */
+  DataBits asBits() const noexcept;
+
+  /*
+    文字列型の値を複製せずに参照します。
+    文字列は終端文字で終わり、長さはsize関数で取得できます。
+    データが文字列型でない場合は空文字列を返します。
+  */
+  const char* asString() const noexcept;
+
+  /*
+    値を複製せずに参照します。
+    Tにはbool、整数型、float、doubleのほか、配列型の値を参照するDataArrayと、文字列型の値を参照するcharを指定できます。
+    データ型がTと一致しない場合はnullptrを返します。
+  */
+  template<class T>
+  const T* tryGet() const noexcept {
+    return _tryGet(static_cast<const T*>(nullptr));
+  }
+
   /*
     String型の値に変換します。
     データがString型でない場合は空文字列を返します。
@@ -241,6 +650,60 @@ public:
   */
   operator std::vector<Data>() const;
 
+  /*
+    bool型の配列の値に変換します。
+    データがbool型の配列ではない場合は空の配列を返します。
+  */
+  operator std::vector<bool>() const;
+
+  /*
+    int8_t型の数値配列の値に変換します。
+    データがint8_t型の数値配列ではない場合は空の配列を返します。
+  */
+  operator std::vector<int8_t>() const;
+
+  /*
+    int16_t型の数値配列の値に変換します。
+    データがint16_t型の数値配列ではない場合は空の配列を返します。
+  */
+  operator std::vector<int16_t>() const;
+
+  /*
+    int32_t型の数値配列の値に変換します。
+    データがint32_t型の数値配列ではない場合は空の配列を返します。
+  */
+  operator std::vector<int32_t>() const;
+
+  /*
+    int64_t型の数値配列の値に変換します。
+    データがint64_t型の数値配列ではない場合は空の配列を返します。
+  */
+  operator std::vector<int64_t>() const;
+
+  /*
+    uint8_t型の数値配列の値に変換します。
+    データがuint8_t型の数値配列ではない場合は空の配列を返します。
+  */
+  operator std::vector<uint8_t>() const;
+
+  /*
+    uint16_t型の数値配列の値に変換します。
+    データがuint16_t型の数値配列ではない場合は空の配列を返します。
+  */
+  operator std::vector<uint16_t>() const;
+
+  /*
+    uint32_t型の数値配列の値に変換します。
+    データがuint32_t型の数値配列ではない場合は空の配列を返します。
+  */
+  operator std::vector<uint32_t>() const;
+
+  /*
+    uint64_t型の数値配列の値に変換します。
+    データがuint64_t型の数値配列ではない場合は空の配列を返します。
+  */
+  operator std::vector<uint64_t>() const;
+
   /*
     bool型の値に変換します。
     データがbool型ではない場合はfalseを返します。
@@ -294,6 +757,148 @@ public:
     データがuint64_t型でない場合は18446744073709551615を返します。
   */
   operator uint64_t() const noexcept;
+
+  /*
+    float型の値に変換します。
+    データがfloat型でない場合はNaNを返します。
+  */
+  operator float() const noexcept;
+
+  /*
+    double型の値に変換します。
+    データがdouble型でない場合はNaNを返します。
+  */
+  operator double() const noexcept;
+};
+
+/*
+  配列型の値を表すクラスです。
+  要素はこのオブジェクトの直後に16バイトずつ連続して格納され、Dataの配列型の値として参照カウントで共有されます。
+  構築やデシリアライズで作られた配列は、要素に続けて長い文字列と入れ子の配列も同じ領域に格納します。
+  DataのasArray関数やtryGet<DataArray>関数で取得し、要素を複製せずに参照します。
+*/
+class alignas(Data) DataArray {
+private:
+  friend class Data;
+
+  std::atomic<uint32_t> _refs;
+  Data::Arena* _arena;  // 領域内に確保された場合はその領域
+  size_t _size;
+
+  DataArray() noexcept
+    : _refs(1), _arena(nullptr), _size(0) {}
+  DataArray(const DataArray&) = delete;
+  DataArray& operator=(const DataArray&) = delete;
+
+  Data* _items() noexcept {
+    return reinterpret_cast<Data*>(this + 1);
+  }
+  static size_t _allocationSize(size_t /* size */) noexcept;
+  static DataArray* _create(size_t /* size */, Data::Arena* /* arena */ = nullptr);
+  template<class Iterator>
+  static DataArray* _create(Iterator /* first */, size_t /* size */);
+  DataArray* _retain() noexcept;
+  void _release() noexcept;
+  DataArray* _unique();
+public:
+  /*
+    要素数を取得します。
+  */
+  size_t size() const noexcept {
+    return _size;
+  }
+
+  /*
+    先頭の要素を指すポインタを取得します。
+  */
+  const Data* begin() const noexcept {
+    return reinterpret_cast<const Data*>(this + 1);
+  }
+
+  /*
+    末尾の要素の次を指すポインタを取得します。
+  */
+  const Data* end() const noexcept {
+    return begin() + _size;
+  }
+
+  /*
+    要素を参照します。
+    添字の範囲は検査しません。
+  */
+  const Data& operator[](size_t index) const noexcept {
+    return begin()[index];
+  }
+
+  /*
+    要素を参照します。
+    添字が範囲外の場合はNull型のデータを返します。
+  */
+  const Data& at(size_t /* index */) const noexcept;
+};
+
+/*
+  bool型の配列の値を参照するクラスです。
+  値は1バイトに8個ずつ、下位ビットから順に詰めて格納されています。
+  DataのasBits関数やDataViewのbits関数で取得し、参照元のデータを使用している間だけ有効です。
+*/
+class DataBits {
+private:
+  const uint8_t* _bytes;
+  size_t _size;
+public:
+  /*
+    空の配列を参照するオブジェクトを構築します。
+  */
+  constexpr DataBits() noexcept
+    : _bytes(nullptr), _size(0) {}
+
+  /*
+    詰めて格納された値と要素数を指定して構築します。
+  */
+  constexpr DataBits(const uint8_t* bytes, size_t size) noexcept
+    : _bytes(bytes), _size(size) {}
+
+  /*
+    要素数を取得します。
+  */
+  size_t size() const noexcept {
+    return _size;
+  }
+
+  /*
+    詰めて格納された値の先頭を取得します。
+    バイト数は(size() + 7) / 8です。
+  */
+  const uint8_t* bytes() const noexcept {
+    return _bytes;
+  }
+
+  /*
+    要素を取得します。
+    添字の範囲は検査しません。
+  */
+  bool operator[](size_t index) const noexcept {
+    return (_bytes[index >> 3] >> (index & 7)) & 1;
+  }
+
+  /*
+    要素を取得します。
+    添字が範囲外の場合はfalseを返します。
+  */
+  bool at(size_t index) const noexcept {
+    return index < _size && operator[](index);
+  }
+
+  /*
+    trueの要素数を取得します。
+  */
+  size_t count() const noexcept {
+    size_t n = 0;
+    for (size_t i = 0; i < (_size + 7) >> 3; ++i)
+      n += __builtin_popcount(_bytes[i]);
+    return n;
+  }
 };
 
 #endif
@@ -0,0 +1,116 @@
+#pragma once
+
+#ifndef DATA_CODEC
+#define DATA_CODEC
+
+#include <Esp.h>
+
+#include <cstring>
+#include <type_traits>
+
+/*
+  シリアライズ形式の値を読み書きするための関数群です。
+  値はすべてリトルエンディアンで格納されます。
+*/
+
+/*
+  整数値を書き込みます。
+*/
+template<class IntType>
+inline void serialize_int(uint8_t* buf, size_t& off, IntType val) {
+  for (size_t i = 0; i < sizeof(IntType); ++i)
+    buf[off++] = (val >> (i << 3)) & 0xFF;
+}
+
+/*
+  整数値を読み出します。
+*/
+template<class IntType>
+inline IntType deserialize_int(const uint8_t* buf, size_t& off) {
+  typename std::make_unsigned<IntType>::type val = 0;
+  for (size_t i = 0; i < sizeof(IntType); ++i)
+    val |= static_cast<decltype(val)>(buf[off++]) << (i << 3);
+  return static_cast<IntType>(val);
+}
+
+/*
+  浮動小数点数をビット列のまま書き込みます。
+*/
+template<class FloatType>
+inline void serialize_float(uint8_t* buf, size_t& off, FloatType val) {
+  memcpy(buf + off, &val, sizeof(FloatType));
+  off += sizeof(FloatType);
+}
+
+/*
+  浮動小数点数を読み出します。
+*/
+template<class FloatType>
+inline FloatType deserialize_float(const uint8_t* buf, size_t& off) {
+  FloatType val;
+  memcpy(&val, buf + off, sizeof(FloatType));
+  off += sizeof(FloatType);
+  return val;
+}
+
+/*
+  符号付き整数値を絶対値が小さいほど小さな符号なし整数値に変換します。（ZigZag符号化）
+  符号なし整数値はそのまま返します。
+*/
+template<class IntType>
+inline uint64_t zigzag_encode(IntType val) {
+  if (std::is_signed<IntType>::value)
+    return (static_cast<uint64_t>(val) << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(val) >> 63);
+  return static_cast<uint64_t>(val);
+}
+
+/*
+  zigzag_encodeで変換した値を元に戻します。
+*/
+template<class IntType>
+inline IntType zigzag_decode(uint64_t val) {
+  if (std::is_signed<IntType>::value)
+    return static_cast<IntType>((val >> 1) ^ (~(val & 1) + 1));
+  return static_cast<IntType>(val);
+}
+
+/*
+  可変長整数（LEB128）で書き込んだときのバイト数を返します。
+*/
+inline size_t varint_size(uint64_t val) {
+  size_t size = 1;
+  while (val >= 0x80) {
+    val >>= 7;
+    ++size;
+  }
+  return size;
+}
+
+/*
+  可変長整数（LEB128）で書き込みます。
+  下位7bitずつ、続きがある場合は最上位bitを立てて書き込みます。
+*/
+inline void serialize_varint(uint8_t* buf, size_t& off, uint64_t val) {
+  while (val >= 0x80) {
+    buf[off++] = static_cast<uint8_t>(val) | 0x80;
+    val >>= 7;
+  }
+  buf[off++] = static_cast<uint8_t>(val);
+}
+
+/*
+  可変長整数（LEB128）をbitsビットの値として読み出します。
+  バッファの終端を超える場合や値がbitsビットに収まらない場合はfalseを返します。
+*/
+inline bool deserialize_varint(const uint8_t* buf, size_t& off, size_t size, size_t bits, uint64_t& val) {
+  val = 0;
+  for (size_t shift = 0; off < size && shift < bits; shift += 7) {
+    uint8_t b = buf[off++];
+    val |= static_cast<uint64_t>(b & 0x7F) << shift;
+    if ((b & 0x80) == 0)
+      return bits >= 64 ? (shift < 63 || (b & 0x7F) <= 1) : (val >> bits) == 0;
+  }
+  return false;
+}
+
+#endif
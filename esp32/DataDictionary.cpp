@@ -0,0 +1,114 @@
+#include "DataDictionary.hpp"
+
+#include <cstring>
+
+DataDictionary::DataDictionary() noexcept
+  : _sent{}, _refresh(0), _messages(0), _misses(0) {}
+
+// FNV-1a
+uint32_t DataDictionary::_hash(const char* str, size_t len) noexcept {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < len; ++i)
+    hash = (hash ^ static_cast<uint8_t>(str[i])) * 16777619u;
+  return hash;
+}
+
+int DataDictionary::_find(const char* str, size_t len) const noexcept {
+  if (_buckets.empty())
+    return -1;
+  uint32_t hash = _hash(str, len);
+  for (int id = _buckets[hash & (_buckets.size() - 1)]; id >= 0; id = _chain[id])
+    if (_hashes[id] == hash && _entries[id].size() == len && memcmp(_entries[id].asString(), str, len) == 0)
+      return id;
+  return -1;
+}
+
+void DataDictionary::_link(uint8_t id) noexcept {
+  int16_t& head = _buckets[_hashes[id] & (_buckets.size() - 1)];
+  _chain[id] = head;
+  head = id;
+}
+
+void DataDictionary::_unlink(uint8_t id) noexcept {
+  int16_t* next = &_buckets[_hashes[id] & (_buckets.size() - 1)];
+  while (*next != id)
+    next = &_chain[*next];
+  *next = _chain[id];
+}
+
+// バケットの数をIDの数以上の2のべき乗にして、定義されているIDを登録し直します。
+void DataDictionary::_rehash() {
+  size_t buckets = _buckets.empty() ? 8 : _buckets.size();
+  while (buckets < _entries.size())
+    buckets <<= 1;
+  _buckets.assign(buckets, -1);
+  for (size_t id = 0; id < _entries.size(); ++id)
+    if (_defined(id))
+      _link(id);
+}
+
+void DataDictionary::_define(uint8_t id, const Data& str) {
+  if (id >= _entries.size()) {
+    _entries.resize(id + 1);
+    _hashes.resize(id + 1);
+    _chain.resize(id + 1, -1);
+  } else if (_defined(id))
+    _unlink(id);
+  _entries[id] = str;
+  _hashes[id] = _hash(str.asString(), str.size());
+  if (_buckets.size() < _entries.size())
+    _rehash();
+  else
+    _link(id);
+}
+
+void DataDictionary::_onMessage() noexcept {
+  if (_refresh != 0 && ++_messages >= _refresh)
+    resync();
+}
+
+int DataDictionary::add(const char* str) {
+  return add(str, strlen(str));
+}
+
+int DataDictionary::add(const char* str, size_t len) {
+  if (len > 0xFFFF)
+    return -1;
+  int id = _find(str, len);
+  if (id >= 0)
+    return id;
+  if (_entries.size() == MAX_ENTRIES)
+    return -1;
+  id = _entries.size();
+  _define(id, Data(str, len));
+  return id;
+}
+
+const Data& DataDictionary::at(uint8_t id) const noexcept {
+  static const Data null;
+  return _defined(id) ? _entries[id] : null;
+}
+
+void DataDictionary::resync() noexcept {
+  memset(_sent, 0, sizeof(_sent));
+  _messages = 0;
+}
+
+void DataDictionary::setRefresh(uint16_t messages) noexcept {
+  _refresh = messages;
+  _messages = 0;
+}
+
+size_t DataDictionary::misses() noexcept {
+  size_t misses = _misses;
+  _misses = 0;
+  return misses;
+}
+
+void DataDictionary::clear() noexcept {
+  _entries.clear();
+  _hashes.clear();
+  _buckets.clear();
+  _chain.clear();
+  resync();
+}
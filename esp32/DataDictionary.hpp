@@ -0,0 +1,97 @@
+#pragma once
+
+#ifndef DATA_DICTIONARY
+#define DATA_DICTIONARY
+
+#include <vector>
+
+#include "Data.hpp"
+
+/*
+  繰り返し送信する文字列に小さなIDを割り当てる辞書です。
+  送信側では、登録した文字列を最初の一回だけ定義（IDと文字列）として書き込み、以降はIDだけを書き込みます。
+  受信側では、定義を受信するたびに文字列を登録し、IDを受信すると登録済みの文字列を共有したデータを返します。
+  定義を含むパケットが失われると、受信側は未定義のIDを含むデータを正しくないデータとして扱い、misses関数で取得できる数に加えます。
+  この場合は送信側でresync関数を呼び出すか、setRefresh関数で一定のメッセージ数ごとに定義を送り直すように設定してください。
+    DataDictionary dict;
+    dict.add("temperature");
+    data.serialize(buf, DataEncoding::Fixed, dict);  // 1回目は定義、2回目以降はIDだけ
+*/
+class DataDictionary {
+private:
+  friend class Data;
+
+  std::vector<Data> _entries;     // IDの順に並べた文字列（定義されていないIDはNull）
+  std::vector<uint32_t> _hashes;  // 文字列のハッシュ値
+  std::vector<int16_t> _buckets;  // ハッシュ値の下位bitごとの最初のID（-1は空）、要素数は2のべき乗
+  std::vector<int16_t> _chain;    // 同じバケットの次のID（-1は終端）
+  uint32_t _sent[256 / 32];       // 定義を書き込んだIDのビット列
+  uint16_t _refresh;               // 定義を送り直すまでのメッセージ数（0の場合は送り直しません）
+  uint16_t _messages;              // 前に定義を送り直してからのメッセージ数
+  size_t _misses;                  // 未定義のIDのためにデシリアライズできなかったデータ数
+
+  static uint32_t _hash(const char* /* str */, size_t /* len */) noexcept;
+  int _find(const char* /* str */, size_t /* len */) const noexcept;
+  void _link(uint8_t /* id */) noexcept;
+  void _unlink(uint8_t /* id */) noexcept;
+  void _rehash();
+  bool _defined(uint8_t id) const noexcept {
+    return id < _entries.size() && _entries[id].type() == DataType::String;
+  }
+  void _define(uint8_t /* id */, const Data& /* str */);
+  void _onMessage() noexcept;
+public:
+  // 登録できる文字列の最大数（IDは1バイトで書き込みます）
+  static const constexpr size_t MAX_ENTRIES = 256;
+
+  DataDictionary() noexcept;
+
+  /*
+    文字列を登録してIDを返します。
+    既に登録されている場合はそのIDを返し、登録できる数を超える場合は-1を返します。
+  */
+  int add(const char* /* str */);
+
+  /*
+    長さを指定して文字列を登録してIDを返します。
+  */
+  int add(const char* /* str */, size_t /* len */);
+
+  /*
+    登録されている文字列を取得します。
+    取得したデータは辞書と文字列を共有するため、メモリの確保は行われません。
+    IDが定義されていない場合はNullを返します。
+  */
+  const Data& at(uint8_t /* id */) const noexcept;
+
+  /*
+    割り当てたIDの数を取得します。
+  */
+  size_t size() const noexcept {
+    return _entries.size();
+  }
+
+  /*
+    すべての文字列の定義を次に使用するときに送り直します。
+    受信側で定義が失われた場合に呼び出します。
+  */
+  void resync() noexcept;
+
+  /*
+    指定したメッセージ数ごとにresync関数を呼び出します。
+    受信側から再送を要求できない場合に設定します。0を指定すると自動では送り直しません。
+  */
+  void setRefresh(uint16_t /* messages */) noexcept;
+
+  /*
+    未定義のIDのためにデシリアライズできなかったデータ数を取得し、0に戻します。
+  */
+  size_t misses() noexcept;
+
+  /*
+    登録した文字列をすべて削除します。
+  */
+  void clear() noexcept;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#include "DataRing.hpp"
+
+DataRing::DataRing(size_t capacity)
+  : _head(0), _tail(0), _bytes(0) {
+  size_t size = 2;
+  while (size < capacity)
+    size <<= 1;
+  _cells = new Cell[size];
+  _mask = size - 1;
+  for (size_t i = 0; i < size; ++i)
+    _cells[i].seq.store(i, std::memory_order_relaxed);
+}
+
+DataRing::~DataRing() {
+  delete[] _cells;
+}
+
+bool DataRing::push(Data& data, size_t bytes) noexcept {
+  size_t pos = _head.load(std::memory_order_relaxed);
+  for (;;) {
+    Cell& cell = _cells[pos & _mask];
+    size_t seq = cell.seq.load(std::memory_order_acquire);
+    intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+    if (diff == 0) {
+      // 他のタスクに先を越された場合は位置を読み直します。
+      if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        cell.data = std::move(data);
+        cell.bytes = bytes;
+        // 取り出す前に加算されるように、公開する前に加算します。
+        _bytes.fetch_add(bytes, std::memory_order_relaxed);
+        cell.seq.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0)
+      return false;
+    else
+      pos = _head.load(std::memory_order_relaxed);
+  }
+}
+
+bool DataRing::pop(Data* const data_p) noexcept {
+  size_t pos = _tail.load(std::memory_order_relaxed);
+  for (;;) {
+    Cell& cell = _cells[pos & _mask];
+    size_t seq = cell.seq.load(std::memory_order_acquire);
+    intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+    if (diff == 0) {
+      if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        *data_p = std::move(cell.data);
+        _bytes.fetch_sub(cell.bytes, std::memory_order_relaxed);
+        cell.seq.store(pos + _mask + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0)
+      return false;
+    else
+      pos = _tail.load(std::memory_order_relaxed);
+  }
+}
+
+size_t DataRing::size() const noexcept {
+  size_t tail = _tail.load(std::memory_order_acquire);
+  size_t head = _head.load(std::memory_order_acquire);
+  return head >= tail ? head - tail : 0;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#ifndef DATA_RING
+#define DATA_RING
+
+#include <atomic>
+
+#include "Data.hpp"
+
+/*
+  受信したデータを受け渡すための、容量が固定されたロックフリーのキューです。
+  要素の領域は構築時に一度だけ確保し、複数のタスクから同時に追加と取り出しを行ってもブロックされません。
+  各要素の通し番号で追加と取り出しの完了を判定します（Dmitry Vyukovの有界MPMCキュー）。
+*/
+class DataRing {
+private:
+  struct Cell {
+    std::atomic<size_t> seq;  // 追加できる場合は位置、取り出せる場合は位置 + 1
+    size_t bytes;             // 追加時に指定されたバイト数
+    Data data;
+  };
+
+  Cell* _cells;
+  size_t _mask;
+  std::atomic<size_t> _head;  // 次に追加する位置
+  std::atomic<size_t> _tail;  // 次に取り出す位置
+  std::atomic<size_t> _bytes;  // 格納されているデータのバイト数の合計
+public:
+  /*
+    容量を指定して構築します。
+    容量は2のべき乗に切り上げられます。
+  */
+  explicit DataRing(size_t /* capacity */);
+
+  DataRing(const DataRing&) = delete;
+  DataRing& operator=(const DataRing&) = delete;
+
+  ~DataRing();
+
+  /*
+    データを末尾に移動して追加します。
+    bytesには受信したバイト数などの、データの大きさの目安を指定します。
+    キューが満杯の場合はfalseを返し、データは変更しません。
+  */
+  bool push(Data& /* data */, size_t /* bytes */ = 0) noexcept;
+
+  /*
+    先頭のデータを取り出します。
+    キューが空の場合はfalseを返します。
+  */
+  bool pop(Data* const /* data_p */) noexcept;
+
+  /*
+    格納されているデータ数を取得します。
+    他のタスクが同時に追加や取り出しを行っている場合は概数になります。
+  */
+  size_t size() const noexcept;
+
+  /*
+    格納されているデータのpushで指定したバイト数の合計を取得します。
+  */
+  size_t bytes() const noexcept {
+    return _bytes.load(std::memory_order_acquire);
+  }
+
+  /*
+    容量を取得します。
+  */
+  size_t capacity() const noexcept {
+    return _mask + 1;
+  }
+};
+
+#endif
@@ -0,0 +1,443 @@
+#pragma once
+
+#ifndef DATA_STRUCT
+#define DATA_STRUCT
+
+#include <array>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "Data.hpp"
+#include "DataCodec.hpp"
+
+/*
+  構造体のメンバを登録するためのテンプレートです。
+  WL_STRUCTマクロで特殊化します。
+*/
+template<class T>
+struct DataStruct;
+
+/*
+  構造体のメンバを配列型のデータと同じ形式で直接シリアライズします。
+  例えば
+    struct Motor { int16_t speed; bool brake; };
+    WL_STRUCT(Motor, speed, brake)
+  と登録すると、Motor型の値は Data{ static_cast<int16_t>(speed), brake } と同じバイト列になります。
+  WL_STRUCTはグローバル名前空間で使用し、メンバは16個まで登録できます。
+*/
+#define WL_STRUCT(TYPE, ...) \
+  template<> \
+  struct DataStruct<TYPE> { \
+    static constexpr auto members() { \
+      return std::make_tuple(WL_STRUCT_MEMBERS(TYPE, __VA_ARGS__)); \
+    } \
+  };
+
+#define WL_STRUCT_EXPAND(x) x
+#define WL_STRUCT_M1(T, m) &T::m
+#define WL_STRUCT_M2(T, m, ...) &T::m, WL_STRUCT_EXPAND(WL_STRUCT_M1(T, __VA_ARGS__))
+#define WL_STRUCT_M3(T, m, ...) &T::m, WL_STRUCT_EXPAND(WL_STRUCT_M2(T, __VA_ARGS__))
+#define WL_STRUCT_M4(T, m, ...) &T::m, WL_STRUCT_EXPAND(WL_STRUCT_M3(T, __VA_ARGS__))
+#define WL_STRUCT_M5(T, m, ...) &T::m, WL_STRUCT_EXPAND(WL_STRUCT_M4(T, __VA_ARGS__))
+#define WL_STRUCT_M6(T, m, ...) &T::m, WL_STRUCT_EXPAND(WL_STRUCT_M5(T, __VA_ARGS__))
+#define WL_STRUCT_M7(T, m, ...) &T::m, WL_STRUCT_EXPAND(WL_STRUCT_M6(T, __VA_ARGS__))
+#define WL_STRUCT_M8(T, m, ...) &T::m, WL_STRUCT_EXPAND(WL_STRUCT_M7(T, __VA_ARGS__))
+#define WL_STRUCT_M9(T, m, ...) &T::m, WL_STRUCT_EXPAND(WL_STRUCT_M8(T, __VA_ARGS__))
+#define WL_STRUCT_M10(T, m, ...) &T::m, WL_STRUCT_EXPAND(WL_STRUCT_M9(T, __VA_ARGS__))
+#define WL_STRUCT_M11(T, m, ...) &T::m, WL_STRUCT_EXPAND(WL_STRUCT_M10(T, __VA_ARGS__))
+#define WL_STRUCT_M12(T, m, ...) &T::m, WL_STRUCT_EXPAND(WL_STRUCT_M11(T, __VA_ARGS__))
+#define WL_STRUCT_M13(T, m, ...) &T::m, WL_STRUCT_EXPAND(WL_STRUCT_M12(T, __VA_ARGS__))
+#define WL_STRUCT_M14(T, m, ...) &T::m, WL_STRUCT_EXPAND(WL_STRUCT_M13(T, __VA_ARGS__))
+#define WL_STRUCT_M15(T, m, ...) &T::m, WL_STRUCT_EXPAND(WL_STRUCT_M14(T, __VA_ARGS__))
+#define WL_STRUCT_M16(T, m, ...) &T::m, WL_STRUCT_EXPAND(WL_STRUCT_M15(T, __VA_ARGS__))
+#define WL_STRUCT_SELECT(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, NAME, ...) NAME
+#define WL_STRUCT_MEMBERS(T, ...) \
+  WL_STRUCT_EXPAND(WL_STRUCT_SELECT(__VA_ARGS__, WL_STRUCT_M16, WL_STRUCT_M15, WL_STRUCT_M14, WL_STRUCT_M13, WL_STRUCT_M12, \
+                                    WL_STRUCT_M11, WL_STRUCT_M10, WL_STRUCT_M9, WL_STRUCT_M8, WL_STRUCT_M7, WL_STRUCT_M6, \
+                                    WL_STRUCT_M5, WL_STRUCT_M4, WL_STRUCT_M3, WL_STRUCT_M2, WL_STRUCT_M1)(T, __VA_ARGS__))
+
+/*
+  メンバの型ごとの読み書きを行うテンプレートです。
+  serializedSizeはシリアライズ後のバイト数を、シリアライズできない場合は0を返します。
+  serializeは書き込んだ後の位置を、バッファが足りない場合は0を返します。
+  deserializeは型が一致しない場合やデータが正しくない場合にfalseを返します。
+*/
+template<class T, class = void>
+struct DataField;
+
+template<>
+struct DataField<bool> {
+  static size_t serializedSize(DataEncoding, bool) {
+    return 1;
+  }
+
+  static size_t serialize(uint8_t* buf, size_t& off, size_t size, DataEncoding, bool val) {
+    if (off + 1 > size) return 0;
+    buf[off++] = val ? TYPE_TRUE : TYPE_FALSE;
+    return off;
+  }
+
+  static bool deserialize(const uint8_t* buf, size_t& off, size_t size, bool& val) {
+    if (off >= size || (buf[off] != TYPE_TRUE && buf[off] != TYPE_FALSE)) return false;
+    val = buf[off++] == TYPE_TRUE;
+    return true;
+  }
+};
+
+// 整数型の型タグ（固定長、可変長）
+template<class T>
+struct DataIntTags;
+template<>
+struct DataIntTags<int8_t> {
+  static const constexpr uint8_t fixed = TYPE_INT8, var = TYPE_INT8;
+};
+template<>
+struct DataIntTags<int16_t> {
+  static const constexpr uint8_t fixed = TYPE_INT16, var = TYPE_VAR_INT16;
+};
+template<>
+struct DataIntTags<int32_t> {
+  static const constexpr uint8_t fixed = TYPE_INT32, var = TYPE_VAR_INT32;
+};
+template<>
+struct DataIntTags<int64_t> {
+  static const constexpr uint8_t fixed = TYPE_INT64, var = TYPE_VAR_INT64;
+};
+template<>
+struct DataIntTags<uint8_t> {
+  static const constexpr uint8_t fixed = TYPE_UINT8, var = TYPE_UINT8;
+};
+template<>
+struct DataIntTags<uint16_t> {
+  static const constexpr uint8_t fixed = TYPE_UINT16, var = TYPE_VAR_UINT16;
+};
+template<>
+struct DataIntTags<uint32_t> {
+  static const constexpr uint8_t fixed = TYPE_UINT32, var = TYPE_VAR_UINT32;
+};
+template<>
+struct DataIntTags<uint64_t> {
+  static const constexpr uint8_t fixed = TYPE_UINT64, var = TYPE_VAR_UINT64;
+};
+
+template<class T>
+struct DataField<T, decltype(void(DataIntTags<T>::fixed))> {
+  static size_t serializedSize(DataEncoding encoding, T val) {
+    if (encoding == DataEncoding::Compact && sizeof(T) > 1)
+      return 1 + varint_size(zigzag_encode(val));
+    return 1 + sizeof(T);
+  }
+
+  static size_t serialize(uint8_t* buf, size_t& off, size_t size, DataEncoding encoding, T val) {
+    if (encoding == DataEncoding::Compact && sizeof(T) > 1) {
+      uint64_t raw = zigzag_encode(val);
+      if (off + 1 + varint_size(raw) > size) return 0;
+      buf[off++] = DataIntTags<T>::var;
+      serialize_varint(buf, off, raw);
+      return off;
+    }
+    if (off + 1 + sizeof(T) > size) return 0;
+    buf[off++] = DataIntTags<T>::fixed;
+    serialize_int(buf, off, val);
+    return off;
+  }
+
+  static bool deserialize(const uint8_t* buf, size_t& off, size_t size, T& val) {
+    if (off >= size) return false;
+    uint8_t tag = buf[off];
+    if (tag == DataIntTags<T>::fixed) {
+      if (off + 1 + sizeof(T) > size) return false;
+      ++off;
+      val = deserialize_int<T>(buf, off);
+      return true;
+    }
+    if (tag != DataIntTags<T>::var) return false;
+    size_t pos = off + 1;
+    uint64_t raw;
+    if (!deserialize_varint(buf, pos, size, sizeof(T) << 3, raw)) return false;
+    val = zigzag_decode<T>(raw);
+    off = pos;
+    return true;
+  }
+};
+
+template<class FloatType, uint8_t TAG>
+struct DataFloatField {
+  static size_t serializedSize(DataEncoding, FloatType) {
+    return 1 + sizeof(FloatType);
+  }
+
+  static size_t serialize(uint8_t* buf, size_t& off, size_t size, DataEncoding, FloatType val) {
+    if (off + 1 + sizeof(FloatType) > size) return 0;
+    buf[off++] = TAG;
+    serialize_float(buf, off, val);
+    return off;
+  }
+
+  static bool deserialize(const uint8_t* buf, size_t& off, size_t size, FloatType& val) {
+    if (off + 1 + sizeof(FloatType) > size || buf[off] != TAG) return false;
+    ++off;
+    val = deserialize_float<FloatType>(buf, off);
+    return true;
+  }
+};
+
+template<>
+struct DataField<float> : DataFloatField<float, TYPE_FLOAT32> {};
+
+template<>
+struct DataField<double> : DataFloatField<double, TYPE_FLOAT64> {};
+
+// 文字列を書き込んだときのバイト数
+inline size_t serialized_struct_string_size(size_t len) {
+  return len > 0xFFFF ? 0 : 1 + 2 + len;
+}
+
+// 文字列の書き込み
+inline size_t serialize_struct_string(uint8_t* buf, size_t& off, size_t size, const char* str, size_t len) {
+  if (len > 0xFFFF || off + 1 + 2 + len > size) return 0;
+  buf[off++] = TYPE_STRING;
+  serialize_int(buf, off, static_cast<uint16_t>(len));
+  memcpy(buf + off, str, len);
+  off += len;
+  return off;
+}
+
+// 文字列の読み出し（先頭と長さを返します）
+inline bool deserialize_struct_string(const uint8_t* buf, size_t& off, size_t size, const char*& str, size_t& len) {
+  if (off + 1 + 2 > size || buf[off] != TYPE_STRING) return false;
+  size_t pos = off + 1;
+  len = deserialize_int<uint16_t>(buf, pos);
+  if (pos + len > size) return false;
+  str = reinterpret_cast<const char*>(buf + pos);
+  off = pos + len;
+  return true;
+}
+
+template<>
+struct DataField<String> {
+  static size_t serializedSize(DataEncoding, const String& val) {
+    return serialized_struct_string_size(val.length());
+  }
+
+  static size_t serialize(uint8_t* buf, size_t& off, size_t size, DataEncoding, const String& val) {
+    return serialize_struct_string(buf, off, size, val.c_str(), val.length());
+  }
+
+  static bool deserialize(const uint8_t* buf, size_t& off, size_t size, String& val) {
+    const char* str;
+    size_t len;
+    if (!deserialize_struct_string(buf, off, size, str, len)) return false;
+    val = String(str, len);
+    return true;
+  }
+};
+
+/*
+  char配列は終端文字までを文字列型として読み書きします。
+  読み出す文字列が配列に収まらない場合はfalseを返します。
+*/
+template<size_t N>
+struct DataField<char[N]> {
+  static size_t serializedSize(DataEncoding, const char (&val)[N]) {
+    return serialized_struct_string_size(strnlen(val, N));
+  }
+
+  static size_t serialize(uint8_t* buf, size_t& off, size_t size, DataEncoding, const char (&val)[N]) {
+    return serialize_struct_string(buf, off, size, val, strnlen(val, N));
+  }
+
+  static bool deserialize(const uint8_t* buf, size_t& off, size_t size, char (&val)[N]) {
+    size_t pos = off;
+    const char* str;
+    size_t len;
+    if (!deserialize_struct_string(buf, pos, size, str, len) || len >= N) return false;
+    memcpy(val, str, len);
+    val[len] = '\0';
+    off = pos;
+    return true;
+  }
+};
+
+/*
+  整数のstd::arrayは要素数が一致する数値配列型として読み書きします。
+*/
+template<class T, size_t N>
+struct DataField<std::array<T, N>, decltype(void(DataIntTags<T>::fixed))> {
+  static constexpr uint8_t tag() {
+    return TYPE_INT8_ARRAY + (std::is_signed<T>::value ? 0 : 4) + (sizeof(T) == 1 ? 0 : sizeof(T) == 2 ? 1 : sizeof(T) == 4 ? 2 : 3);
+  }
+
+  static size_t serializedSize(DataEncoding, const std::array<T, N>&) {
+    return 1 + 2 + sizeof(T) * N;
+  }
+
+  static size_t serialize(uint8_t* buf, size_t& off, size_t size, DataEncoding, const std::array<T, N>& val) {
+    static_assert(N <= 0xFFFF, "too many elements");
+    if (off + 1 + 2 + sizeof(T) * N > size) return 0;
+    buf[off++] = tag();
+    serialize_int(buf, off, static_cast<uint16_t>(N));
+    for (const T& v : val)
+      serialize_int(buf, off, v);
+    return off;
+  }
+
+  static bool deserialize(const uint8_t* buf, size_t& off, size_t size, std::array<T, N>& val) {
+    if (off + 1 + 2 + sizeof(T) * N > size || buf[off] != tag()) return false;
+    size_t pos = off + 1;
+    if (deserialize_int<uint16_t>(buf, pos) != N) return false;
+    for (T& v : val)
+      v = deserialize_int<T>(buf, pos);
+    off = pos;
+    return true;
+  }
+};
+
+/*
+  boolのstd::arrayは要素数が一致するbool型の配列として、1バイトに8個ずつ詰めて読み書きします。
+*/
+template<size_t N>
+struct DataField<std::array<bool, N>, void> {
+  static constexpr size_t bytes = (N + 7) >> 3;
+
+  static size_t serializedSize(DataEncoding, const std::array<bool, N>&) {
+    return 1 + 2 + bytes;
+  }
+
+  static size_t serialize(uint8_t* buf, size_t& off, size_t size, DataEncoding, const std::array<bool, N>& val) {
+    static_assert(N <= 0xFFFF, "too many elements");
+    if (off + 1 + 2 + bytes > size) return 0;
+    buf[off++] = TYPE_BOOL_ARRAY;
+    serialize_int(buf, off, static_cast<uint16_t>(N));
+    memset(buf + off, 0, bytes);
+    for (size_t i = 0; i < N; ++i)
+      if (val[i])
+        buf[off + (i >> 3)] |= 1 << (i & 7);
+    off += bytes;
+    return off;
+  }
+
+  static bool deserialize(const uint8_t* buf, size_t& off, size_t size, std::array<bool, N>& val) {
+    if (off + 1 + 2 + bytes > size || buf[off] != TYPE_BOOL_ARRAY) return false;
+    size_t pos = off + 1;
+    if (deserialize_int<uint16_t>(buf, pos) != N) return false;
+    for (size_t i = 0; i < N; ++i)
+      val[i] = (buf[pos + (i >> 3)] >> (i & 7)) & 1;
+    off = pos + bytes;
+    return true;
+  }
+};
+
+/*
+  WL_STRUCTで登録した構造体は配列型として読み書きします。
+  メンバに登録した構造体を含めることもできます。
+*/
+template<class T>
+struct DataField<T, decltype(void(DataStruct<T>::members()))> {
+  static constexpr size_t count = std::tuple_size<decltype(DataStruct<T>::members())>::value;
+
+  template<size_t... I>
+  static size_t serializedMembersSize(DataEncoding encoding, const T& val, std::index_sequence<I...>) {
+    constexpr auto members = DataStruct<T>::members();
+    size_t size = 0;
+    (void)members;
+    (void)(... && (_addMemberSize(size, encoding, val.*std::get<I>(members))));
+    return size;
+  }
+
+  template<size_t... I>
+  static size_t serializeMembers(uint8_t* buf, size_t& off, size_t size, DataEncoding encoding, const T& val, std::index_sequence<I...>) {
+    constexpr auto members = DataStruct<T>::members();
+    bool ok = true;
+    (void)members;
+    (void)(... && (ok = _serializeMember(buf, off, size, encoding, val.*std::get<I>(members)) != 0));
+    return ok ? off : 0;
+  }
+
+  template<size_t... I>
+  static bool deserializeMembers(const uint8_t* buf, size_t& off, size_t size, T& val, std::index_sequence<I...>) {
+    constexpr auto members = DataStruct<T>::members();
+    (void)members;
+    return (... && _deserializeMember(buf, off, size, val.*std::get<I>(members)));
+  }
+
+  static size_t serializedSize(DataEncoding encoding, const T& val) {
+    size_t size = serializedMembersSize(encoding, val, std::make_index_sequence<count>());
+    return size == 0 && count != 0 ? 0 : 1 + 2 + size;
+  }
+
+  static size_t serialize(uint8_t* buf, size_t& off, size_t size, DataEncoding encoding, const T& val) {
+    if (off + 1 + 2 > size) return 0;
+    buf[off++] = TYPE_ARRAY;
+    serialize_int(buf, off, static_cast<uint16_t>(count));
+    return serializeMembers(buf, off, size, encoding, val, std::make_index_sequence<count>());
+  }
+
+  static bool deserialize(const uint8_t* buf, size_t& off, size_t size, T& val) {
+    if (off + 1 + 2 > size || buf[off] != TYPE_ARRAY) return false;
+    size_t pos = off + 1;
+    if (deserialize_int<uint16_t>(buf, pos) != count) return false;
+    if (!deserializeMembers(buf, pos, size, val, std::make_index_sequence<count>())) return false;
+    off = pos;
+    return true;
+  }
+
+private:
+  // メンバのバイト数を加算します。シリアライズできない場合はsizeを0にしてfalseを返します。
+  template<class M>
+  static bool _addMemberSize(size_t& size, DataEncoding encoding, const M& member) {
+    size_t member_size = DataField<M>::serializedSize(encoding, member);
+    size = member_size == 0 ? 0 : size + member_size;
+    return member_size != 0;
+  }
+
+  template<class M>
+  static size_t _serializeMember(uint8_t* buf, size_t& off, size_t size, DataEncoding encoding, const M& member) {
+    return DataField<M>::serialize(buf, off, size, encoding, member);
+  }
+
+  template<class M>
+  static bool _deserializeMember(const uint8_t* buf, size_t& off, size_t size, M& member) {
+    return DataField<M>::deserialize(buf, off, size, member);
+  }
+};
+
+/*
+  WL_STRUCTで登録した構造体の値をシリアライズしたときのバイト数を取得します。
+  65535文字より長い文字列を含むなど、シリアライズできない場合は0を返します。
+*/
+template<class T>
+size_t serializedSizeStruct(const T& val, DataEncoding encoding = DataEncoding::Fixed) {
+  return DataField<T>::serializedSize(encoding, val);
+}
+
+/*
+  WL_STRUCTで登録した構造体の値をシリアライズします。
+  バッファが足りない場合は0を返します。
+*/
+template<class T>
+size_t serializeStruct(const T& val, uint8_t* buf, size_t off, size_t size, DataEncoding encoding = DataEncoding::Fixed) {
+  return DataField<T>::serialize(buf, off, size, encoding, val);
+}
+
+/*
+  WL_STRUCTで登録した構造体の値をシリアライズします。
+*/
+template<class T>
+size_t serializeStruct(const T& val, uint8_t* buf, size_t size, DataEncoding encoding = DataEncoding::Fixed) {
+  return serializeStruct(val, buf, 0, size, encoding);
+}
+
+/*
+  WL_STRUCTで登録した構造体の値をデシリアライズします。
+  要素数や要素の型が一致しない場合はfalseを返します。
+*/
+template<class T>
+bool deserializeStruct(const uint8_t* buf, size_t size, T* val_p) {
+  size_t off = 0;
+  return DataField<T>::deserialize(buf, off, size, *val_p) && off == size;
+}
+
+#endif
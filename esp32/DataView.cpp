@@ -0,0 +1,334 @@
+#include "DataView.hpp"
+#include "DataCodec.hpp"
+#include "DataDictionary.hpp"
+
+#include <cmath>
+#include <cstring>
+
+template<class IntType>
+static IntType read_int(const uint8_t* buf) {
+  size_t off = 0;
+  return deserialize_int<IntType>(buf, off);
+}
+
+template<class FloatType>
+static FloatType read_float(const uint8_t* buf) {
+  size_t off = 0;
+  return deserialize_float<FloatType>(buf, off);
+}
+
+/*
+  固定長または可変長で書き込まれた整数値を読み出します。
+  データの型タグがtagでもvar_tagでもない場合はerrorを返します。
+*/
+template<class IntType>
+static IntType read_int(const uint8_t* buf, size_t size, uint8_t tag, uint8_t var_tag, IntType error) {
+  if (buf == nullptr)
+    return error;
+  if (buf[0] == tag)
+    return read_int<IntType>(buf + 1);
+  size_t off = 1;
+  uint64_t raw;
+  if (buf[0] == var_tag && deserialize_varint(buf, off, size, sizeof(IntType) << 3, raw))
+    return zigzag_decode<IntType>(raw);
+  return error;
+}
+
+/*
+  先頭のデータを読み飛ばし、そのバイト数を返します。
+  配列の要素は残りの要素数を数えながら読み飛ばすため、入れ子が深くてもスタックを消費しません。
+  データが正しくない場合は0を返します。
+*/
+size_t DataView::_skip(const uint8_t* buf, size_t size) {
+  size_t off = 0;
+  size_t rest = 1;  // 読み飛ばす残りのデータ数
+  while (rest > 0) {
+    if (off >= size) return 0;
+    size_t width;
+    switch (buf[off++]) {
+      case TYPE_NULL:
+      case TYPE_TRUE:
+      case TYPE_FALSE:
+        width = 0;
+        break;
+      case TYPE_STRING:
+        if (off + 2 > size) return 0;
+        width = 2 + read_int<uint16_t>(buf + off);
+        break;
+      case TYPE_STRING_DEF:
+        if (off + 1 + 2 > size) return 0;
+        width = 1 + 2 + read_int<uint16_t>(buf + off + 1);
+        break;
+      case TYPE_STRING_REF:
+        width = 1;
+        break;
+      case TYPE_ARRAY:
+        if (off + 2 > size) return 0;
+        rest += read_int<uint16_t>(buf + off);
+        width = 2;
+        break;
+      case TYPE_INT8:
+      case TYPE_UINT8:
+        width = 1;
+        break;
+      case TYPE_INT16:
+      case TYPE_UINT16:
+        width = 2;
+        break;
+      case TYPE_INT32:
+      case TYPE_UINT32:
+      case TYPE_FLOAT32:
+        width = 4;
+        break;
+      case TYPE_INT64:
+      case TYPE_UINT64:
+      case TYPE_FLOAT64:
+        width = 8;
+        break;
+      case TYPE_VAR_INT16:
+      case TYPE_VAR_UINT16:
+      case TYPE_VAR_INT32:
+      case TYPE_VAR_UINT32:
+      case TYPE_VAR_INT64:
+      case TYPE_VAR_UINT64:
+        {
+          static const constexpr size_t bits[] = { 16, 32, 64 };
+          uint64_t raw;
+          if (!deserialize_varint(buf, off, size, bits[(buf[off - 1] - TYPE_VAR_INT16) % 3], raw)) return 0;
+          width = 0;
+        }
+        break;
+      case TYPE_INT8_ARRAY:
+      case TYPE_INT16_ARRAY:
+      case TYPE_INT32_ARRAY:
+      case TYPE_INT64_ARRAY:
+      case TYPE_UINT8_ARRAY:
+      case TYPE_UINT16_ARRAY:
+      case TYPE_UINT32_ARRAY:
+      case TYPE_UINT64_ARRAY:
+        if (off + 2 > size) return 0;
+        width = 2 + (read_int<uint16_t>(buf + off) << ((buf[off - 1] - TYPE_INT8_ARRAY) & 3));
+        break;
+      case TYPE_BOOL_ARRAY:
+        if (off + 2 > size) return 0;
+        width = 2 + ((read_int<uint16_t>(buf + off) + 7) >> 3);
+        break;
+      case TYPE_TIME_SERIES:
+        if (off + 1 + 2 + 2 > size || buf[off] > static_cast<uint8_t>(TimeSeriesType::Int64)) return 0;
+        width = 1 + 2 + 2 + read_int<uint16_t>(buf + off + 1 + 2);
+        break;
+      default:
+        return 0;
+    }
+    if (off + width > size) return 0;
+    off += width;
+    --rest;
+  }
+  return off;
+}
+
+DataView::DataView(const uint8_t* buf, size_t size)
+  : DataView(buf, size, nullptr) {}
+
+DataView::DataView(const uint8_t* buf, size_t size, DataDictionary& dict)
+  : DataView(buf, size, &dict) {}
+
+DataView::DataView(const uint8_t* buf, size_t size, DataDictionary* dict)
+  : _buf(buf), _size(buf != nullptr ? _skip(buf, size) : 0), _dict(dict) {
+  if (_size == 0)
+    _buf = nullptr;
+}
+
+// 文字列のIDが参照する辞書の文字列（参照できない場合はNull）を取得します。
+const Data& DataView::_entry() const noexcept {
+  static const Data null;
+  return _dict != nullptr ? _dict->at(_payload()[0]) : null;
+}
+
+DataType DataView::type() const noexcept {
+  if (_buf == nullptr)
+    return DataType::Null;
+  switch (_buf[0]) {
+    case TYPE_TRUE:
+    case TYPE_FALSE:
+      return DataType::Bool;
+    case TYPE_STRING:
+    case TYPE_STRING_DEF:
+      return DataType::String;
+    case TYPE_STRING_REF:
+      return _entry().type();
+    case TYPE_ARRAY:
+      return DataType::Array;
+    case TYPE_INT8:
+      return DataType::Int8;
+    case TYPE_INT16:
+    case TYPE_VAR_INT16:
+      return DataType::Int16;
+    case TYPE_INT32:
+    case TYPE_VAR_INT32:
+      return DataType::Int32;
+    case TYPE_INT64:
+    case TYPE_VAR_INT64:
+      return DataType::Int64;
+    case TYPE_UINT8:
+      return DataType::UInt8;
+    case TYPE_UINT16:
+    case TYPE_VAR_UINT16:
+      return DataType::UInt16;
+    case TYPE_UINT32:
+    case TYPE_VAR_UINT32:
+      return DataType::UInt32;
+    case TYPE_UINT64:
+    case TYPE_VAR_UINT64:
+      return DataType::UInt64;
+    case TYPE_INT8_ARRAY:
+      return DataType::Int8Array;
+    case TYPE_INT16_ARRAY:
+      return DataType::Int16Array;
+    case TYPE_INT32_ARRAY:
+      return DataType::Int32Array;
+    case TYPE_INT64_ARRAY:
+      return DataType::Int64Array;
+    case TYPE_UINT8_ARRAY:
+      return DataType::UInt8Array;
+    case TYPE_UINT16_ARRAY:
+      return DataType::UInt16Array;
+    case TYPE_UINT32_ARRAY:
+      return DataType::UInt32Array;
+    case TYPE_UINT64_ARRAY:
+      return DataType::UInt64Array;
+    case TYPE_FLOAT32:
+      return DataType::Float32;
+    case TYPE_FLOAT64:
+      return DataType::Float64;
+    case TYPE_BOOL_ARRAY:
+      return DataType::BoolArray;
+    case TYPE_TIME_SERIES:
+      return DataType::TimeSeries;
+    default:
+      return DataType::Null;
+  }
+}
+
+size_t DataView::size() const noexcept {
+  DataType t = type();
+  if (t == DataType::String && _buf[0] != TYPE_STRING)
+    return _buf[0] == TYPE_STRING_DEF ? read_int<uint16_t>(_payload() + 1) : _entry().size();
+  if (t == DataType::TimeSeries)
+    return read_int<uint16_t>(_payload() + 1);
+  return t == DataType::String || t == DataType::Array || (t >= DataType::Int8Array && t <= DataType::UInt64Array) || t == DataType::BoolArray ? read_int<uint16_t>(_payload()) : 0;
+}
+
+DataView DataView::operator[](size_t index) const noexcept {
+  if (type() != DataType::Array || index >= size())
+    return DataView();
+  const uint8_t* buf = _payload() + 2;
+  size_t rest = _size - 3;
+  for (size_t i = 0; i < index; ++i) {
+    size_t skipped = _skip(buf, rest);
+    buf += skipped;
+    rest -= skipped;
+  }
+  return DataView(buf, rest, _dict);
+}
+
+DataView::Iterator DataView::begin() const noexcept {
+  if (type() != DataType::Array)
+    return Iterator(nullptr, 0, 0, nullptr);
+  return Iterator(_payload() + 2, _size - 3, 0, _dict);
+}
+
+DataView::Iterator DataView::end() const noexcept {
+  return Iterator(nullptr, 0, size(), nullptr);
+}
+
+DataView::Iterator& DataView::Iterator::operator++() noexcept {
+  size_t skipped = _current._size;
+  _rest -= skipped;
+  _current = DataView(_current._buf + skipped, _rest, _current._dict);
+  ++_index;
+  return *this;
+}
+
+const char* DataView::chars() const noexcept {
+  if (type() != DataType::String)
+    return nullptr;
+  switch (_buf[0]) {
+    case TYPE_STRING_DEF:
+      return reinterpret_cast<const char*>(_payload() + 1 + 2);
+    case TYPE_STRING_REF:
+      return _entry().asString();
+    default:
+      return reinterpret_cast<const char*>(_payload() + 2);
+  }
+}
+
+DataBits DataView::bits() const noexcept {
+  return type() == DataType::BoolArray ? DataBits(_payload() + 2, size()) : DataBits();
+}
+
+bool DataView::operator==(const char* str) const noexcept {
+  if (type() != DataType::String || str == nullptr)
+    return false;
+  size_t len = size();
+  return strlen(str) == len && memcmp(chars(), str, len) == 0;
+}
+
+Data DataView::toData() const {
+  Data data;
+  if (_buf != nullptr) {
+    if (_dict != nullptr)
+      Data::deserialize(_buf, _size, &data, *_dict);
+    else
+      Data::deserialize(_buf, _size, &data);
+  }
+  return data;
+}
+
+DataView::operator String() const {
+  return type() == DataType::String ? String(chars(), size()) : String();
+}
+
+DataView::operator bool() const noexcept {
+  return _buf != nullptr && _buf[0] == TYPE_TRUE;
+}
+
+DataView::operator int8_t() const noexcept {
+  return type() == DataType::Int8 ? read_int<int8_t>(_payload()) : static_cast<int8_t>(-1);
+}
+
+DataView::operator int16_t() const noexcept {
+  return read_int(_buf, _size, TYPE_INT16, TYPE_VAR_INT16, static_cast<int16_t>(-1));
+}
+
+DataView::operator int32_t() const noexcept {
+  return read_int(_buf, _size, TYPE_INT32, TYPE_VAR_INT32, static_cast<int32_t>(-1));
+}
+
+DataView::operator int64_t() const noexcept {
+  return read_int(_buf, _size, TYPE_INT64, TYPE_VAR_INT64, static_cast<int64_t>(-1));
+}
+
+DataView::operator uint8_t() const noexcept {
+  return type() == DataType::UInt8 ? read_int<uint8_t>(_payload()) : static_cast<uint8_t>(0xFF);
+}
+
+DataView::operator uint16_t() const noexcept {
+  return read_int(_buf, _size, TYPE_UINT16, TYPE_VAR_UINT16, static_cast<uint16_t>(0xFFFF));
+}
+
+DataView::operator uint32_t() const noexcept {
+  return read_int(_buf, _size, TYPE_UINT32, TYPE_VAR_UINT32, static_cast<uint32_t>(0xFFFFFFFF));
+}
+
+DataView::operator uint64_t() const noexcept {
+  return read_int(_buf, _size, TYPE_UINT64, TYPE_VAR_UINT64, static_cast<uint64_t>(0xFFFFFFFFFFFFFFFF));
+}
+
+DataView::operator float() const noexcept {
+  return type() == DataType::Float32 ? read_float<float>(_payload()) : NAN;
+}
+
+DataView::operator double() const noexcept {
+  return type() == DataType::Float64 ? read_float<double>(_payload()) : NAN;
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+#ifndef DATA_VIEW
+#define DATA_VIEW
+
+#include "Data.hpp"
+
+/*
+  シリアライズされたデータを展開せずに参照するクラスです。
+  値は参照されたときに必要な部分だけが読み出され、メモリの確保は行いません。
+  参照するバッファはDataViewを使用している間は解放してはいけません。
+  辞書を使用してシリアライズされたデータは、辞書を指定して構築すると文字列のIDを辞書の文字列として参照します。
+*/
+class DataView {
+private:
+  friend class TimeSeriesDecoder;
+
+  const uint8_t* _buf;    // データの先頭
+  size_t _size;           // データのバイト数
+  DataDictionary* _dict;  // 文字列のIDを参照する辞書（指定されていない場合はnullptr）
+
+  static size_t _skip(const uint8_t* /* buf */, size_t /* size */);
+  DataView(const uint8_t* /* buf */, size_t /* size */, DataDictionary* /* dict */);
+  const uint8_t* _payload() const noexcept {
+    return _buf + 1;
+  }
+  const Data& _entry() const noexcept;
+public:
+  class Iterator;
+
+  /*
+    Nullを表すビューを構築します。
+  */
+  constexpr DataView() noexcept
+    : _buf(nullptr), _size(0), _dict(nullptr) {}
+
+  /*
+    シリアライズされたデータを参照するビューを構築します。
+    バッファの先頭にあるデータを参照し、後続のバイトは無視します。
+    バッファの先頭に正しいデータがない場合はNullを表すビューになります。
+  */
+  DataView(const uint8_t* /* buf */, size_t /* size */);
+
+  /*
+    辞書を使用してシリアライズされたデータを参照するビューを構築します。
+    文字列の定義はそのまま文字列として、IDは辞書に登録されている文字列として参照します。
+    定義の登録はtoData関数で展開したときにだけ行います。
+  */
+  DataView(const uint8_t* /* buf */, size_t /* size */, DataDictionary& /* dict */);
+
+  /*
+    ビューが正しいデータを参照していればtrueを返します。
+  */
+  bool valid() const noexcept {
+    return _buf != nullptr;
+  }
+
+  /*
+    参照しているデータのバイト数を取得します。
+  */
+  size_t encodedSize() const noexcept {
+    return _size;
+  }
+
+  /*
+    データ型を取得します。
+  */
+  DataType type() const noexcept;
+
+  /*
+    文字列型の長さ、配列型、数値配列型、bool型の配列または時系列の要素数を取得します。
+    それ以外のデータ型の場合は0を返します。
+  */
+  size_t size() const noexcept;
+
+  /*
+    配列型の要素を参照するビューを取得します。
+    先頭から添字の位置まで要素を読み飛ばします。
+    データが配列型でない場合や添字が範囲外の場合はNullを表すビューを返します。
+  */
+  DataView operator[](size_t /* index */) const noexcept;
+
+  /*
+    配列型の最初の要素を指すイテレータを取得します。
+  */
+  Iterator begin() const noexcept;
+
+  /*
+    配列型の最後の要素の次を指すイテレータを取得します。
+  */
+  Iterator end() const noexcept;
+
+  /*
+    文字列型の値の先頭を取得します。
+    文字列は終端文字で終わっていないため、長さはsize関数で取得してください。
+    データが文字列型でない場合はnullptrを返します。
+  */
+  const char* chars() const noexcept;
+
+  /*
+    bool型の配列の値を参照します。
+    データがbool型の配列でない場合は空の配列を返します。
+  */
+  DataBits bits() const noexcept;
+
+  /*
+    データ型と値が文字列と等しければtrue、そうでなければfalseを返します。
+  */
+  bool operator==(const char*) const noexcept;
+
+  /*
+    データ型と値が文字列と異なればtrue、そうでなければfalseを返します。
+  */
+  bool operator!=(const char* str) const noexcept {
+    return !operator==(str);
+  }
+
+  /*
+    参照しているデータをDataに展開します。
+    辞書を指定して構築した場合は辞書を使用してデシリアライズし、含まれている定義を辞書に登録します。
+  */
+  Data toData() const;
+
+  /*
+    String型の値に変換します。
+    データがString型でない場合は空文字列を返します。
+  */
+  operator String() const;
+
+  /*
+    bool型の値に変換します。
+    データがbool型ではない場合はfalseを返します。
+  */
+  operator bool() const noexcept;
+
+  /*
+    int8_t型の値に変換します。
+    データがint8_t型ではない場合は-1を返します。
+  */
+  operator int8_t() const noexcept;
+
+  /*
+    int16_t型の値に変換します。
+    データがint16_t型ではない場合は-1を返します。
+  */
+  operator int16_t() const noexcept;
+
+  /*
+    int32_t型の値に変換します。
+    データがint32_t型ではない場合は-1を返します。
+  */
+  operator int32_t() const noexcept;
+
+  /*
+    int64_t型の値に変換します。
+    データがint64_t型ではない場合は-1を返します。
+  */
+  operator int64_t() const noexcept;
+
+  /*
+    uint8_t型の値に変換します。
+    データがuint8_t型でない場合は255を返します。
+  */
+  operator uint8_t() const noexcept;
+
+  /*
+    uint16_t型の値に変換します。
+    データがuint16_t型でない場合は65535を返します。
+  */
+  operator uint16_t() const noexcept;
+
+  /*
+    uint32_t型の値に変換します。
+    データがuint32_t型でない場合は4294967295を返します。
+  */
+  operator uint32_t() const noexcept;
+
+  /*
+    uint64_t型の値に変換します。
+    データがuint64_t型でない場合は18446744073709551615を返します。
+  */
+  operator uint64_t() const noexcept;
+
+  /*
+    float型の値に変換します。
+    データがfloat型でない場合はNaNを返します。
+  */
+  operator float() const noexcept;
+
+  /*
+    double型の値に変換します。
+    データがdouble型でない場合はNaNを返します。
+  */
+  operator double() const noexcept;
+};
+
+/*
+  配列型の要素を順番に参照するイテレータです。
+*/
+class DataView::Iterator {
+private:
+  DataView _current;  // 現在の要素
+  size_t _rest;       // 現在の要素以降のバイト数
+  size_t _index;      // 現在の要素の添字
+
+  friend class DataView;
+  Iterator(const uint8_t* buf, size_t rest, size_t index, DataDictionary* dict) noexcept
+    : _current(buf, rest, dict), _rest(rest), _index(index) {}
+public:
+  const DataView& operator*() const noexcept {
+    return _current;
+  }
+
+  const DataView* operator->() const noexcept {
+    return &_current;
+  }
+
+  Iterator& operator++() noexcept;
+
+  bool operator==(const Iterator& other) const noexcept {
+    return _index == other._index;
+  }
+
+  bool operator!=(const Iterator& other) const noexcept {
+    return _index != other._index;
+  }
+};
+
+#endif
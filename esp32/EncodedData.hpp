@@ -0,0 +1,310 @@
+#pragma once
+
+#ifndef ENCODED_DATA
+#define ENCODED_DATA
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#include "Data.hpp"
+#include "DataCodec.hpp"
+#include "DataStruct.hpp"
+
+/*
+  コンパイル時にシリアライズしたデータです。
+  encodeLiteral関数やencodeArrayLiteral関数で構築し、static constexprな変数に格納するとフラッシュメモリに配置されます。
+*/
+template<size_t N>
+struct EncodedLiteral {
+  uint8_t bytes[N];
+
+  constexpr size_t size() const noexcept {
+    return N;
+  }
+};
+
+// 値をシリアライズしたときのバイト数
+template<class T>
+struct EncodedLiteralSize;
+template<>
+struct EncodedLiteralSize<std::nullptr_t> : std::integral_constant<size_t, 1> {};
+template<>
+struct EncodedLiteralSize<bool> : std::integral_constant<size_t, 1> {};
+template<>
+struct EncodedLiteralSize<int8_t> : std::integral_constant<size_t, 1 + 1> {};
+template<>
+struct EncodedLiteralSize<int16_t> : std::integral_constant<size_t, 1 + 2> {};
+template<>
+struct EncodedLiteralSize<int32_t> : std::integral_constant<size_t, 1 + 4> {};
+template<>
+struct EncodedLiteralSize<int64_t> : std::integral_constant<size_t, 1 + 8> {};
+template<>
+struct EncodedLiteralSize<uint8_t> : std::integral_constant<size_t, 1 + 1> {};
+template<>
+struct EncodedLiteralSize<uint16_t> : std::integral_constant<size_t, 1 + 2> {};
+template<>
+struct EncodedLiteralSize<uint32_t> : std::integral_constant<size_t, 1 + 4> {};
+template<>
+struct EncodedLiteralSize<uint64_t> : std::integral_constant<size_t, 1 + 8> {};
+template<size_t N>
+struct EncodedLiteralSize<char[N]> : std::integral_constant<size_t, 1 + 2 + N - 1> {};
+template<size_t N>
+struct EncodedLiteralSize<EncodedLiteral<N>> : std::integral_constant<size_t, N> {};
+
+template<class IntType>
+constexpr void write_literal_int(uint8_t* buf, size_t& off, uint8_t tag, IntType val) {
+  buf[off++] = tag;
+  for (size_t i = 0; i < sizeof(IntType); ++i)
+    buf[off++] = static_cast<uint8_t>(static_cast<uint64_t>(val) >> (i << 3));
+}
+
+constexpr void write_literal(uint8_t* buf, size_t& off, std::nullptr_t) {
+  buf[off++] = TYPE_NULL;
+}
+constexpr void write_literal(uint8_t* buf, size_t& off, bool val) {
+  buf[off++] = val ? TYPE_TRUE : TYPE_FALSE;
+}
+constexpr void write_literal(uint8_t* buf, size_t& off, int8_t val) {
+  write_literal_int(buf, off, TYPE_INT8, val);
+}
+constexpr void write_literal(uint8_t* buf, size_t& off, int16_t val) {
+  write_literal_int(buf, off, TYPE_INT16, val);
+}
+constexpr void write_literal(uint8_t* buf, size_t& off, int32_t val) {
+  write_literal_int(buf, off, TYPE_INT32, val);
+}
+constexpr void write_literal(uint8_t* buf, size_t& off, int64_t val) {
+  write_literal_int(buf, off, TYPE_INT64, val);
+}
+constexpr void write_literal(uint8_t* buf, size_t& off, uint8_t val) {
+  write_literal_int(buf, off, TYPE_UINT8, val);
+}
+constexpr void write_literal(uint8_t* buf, size_t& off, uint16_t val) {
+  write_literal_int(buf, off, TYPE_UINT16, val);
+}
+constexpr void write_literal(uint8_t* buf, size_t& off, uint32_t val) {
+  write_literal_int(buf, off, TYPE_UINT32, val);
+}
+constexpr void write_literal(uint8_t* buf, size_t& off, uint64_t val) {
+  write_literal_int(buf, off, TYPE_UINT64, val);
+}
+template<size_t N>
+constexpr void write_literal(uint8_t* buf, size_t& off, const char (&str)[N]) {
+  buf[off++] = TYPE_STRING;
+  buf[off++] = static_cast<uint8_t>(N - 1);
+  buf[off++] = static_cast<uint8_t>((N - 1) >> 8);
+  for (size_t i = 0; i + 1 < N; ++i)
+    buf[off++] = static_cast<uint8_t>(str[i]);
+}
+template<size_t N>
+constexpr void write_literal(uint8_t* buf, size_t& off, const EncodedLiteral<N>& literal) {
+  for (size_t i = 0; i < N; ++i)
+    buf[off++] = literal.bytes[i];
+}
+
+/*
+  値をコンパイル時にシリアライズします。
+  値にはnullptr、bool、整数型（型を明示してください）、文字列リテラル、encodeArrayLiteralで構築した配列を指定できます。
+*/
+template<class T>
+constexpr EncodedLiteral<EncodedLiteralSize<T>::value> encodeLiteral(const T& val) {
+  EncodedLiteral<EncodedLiteralSize<T>::value> literal{};
+  size_t off = 0;
+  write_literal(literal.bytes, off, val);
+  return literal;
+}
+
+/*
+  値を要素とする配列型のデータをコンパイル時にシリアライズします。
+    static constexpr auto HEARTBEAT = encodeArrayLiteral("heartbeat", static_cast<uint8_t>(1), true);
+*/
+template<class... T>
+constexpr EncodedLiteral<1 + 2 + (EncodedLiteralSize<T>::value + ... + 0)> encodeArrayLiteral(const T&... vals) {
+  static_assert(sizeof...(T) <= 0xFFFF, "too many elements");
+  EncodedLiteral<1 + 2 + (EncodedLiteralSize<T>::value + ... + 0)> literal{};
+  size_t off = 0;
+  literal.bytes[off++] = TYPE_ARRAY;
+  literal.bytes[off++] = static_cast<uint8_t>(sizeof...(T));
+  literal.bytes[off++] = static_cast<uint8_t>(sizeof...(T) >> 8);
+  (write_literal(literal.bytes, off, vals), ...);
+  return literal;
+}
+
+/*
+  シリアライズ済みのデータを表すクラスです。
+  wlTxWriteやserialWriteに渡すと、シリアライズせずにそのまま送信されます。
+  同じデータを繰り返し送信する場合に使用します。
+*/
+class EncodedData {
+protected:
+  std::vector<uint8_t> _buf;  // 実行時にシリアライズした場合のバイト列
+  const uint8_t* _bytes;
+  size_t _size;
+public:
+  /*
+    データをシリアライズして保持します。
+    シリアライズできない場合は空になります。
+  */
+  explicit EncodedData(const Data& data, DataEncoding encoding = DataEncoding::Fixed) {
+    data.serialize(_buf, encoding);
+    _bytes = _buf.data();
+    _size = _buf.size();
+  }
+
+  /*
+    コンパイル時にシリアライズしたデータを参照します。
+    データは複製されないため、static constexprな変数に格納したものを渡してください。
+  */
+  template<size_t N>
+  EncodedData(const EncodedLiteral<N>& literal) noexcept
+    : _buf(), _bytes(literal.bytes), _size(N) {}
+
+  EncodedData(const EncodedData& other)
+    : _buf(other._buf), _bytes(other._buf.empty() ? other._bytes : _buf.data()), _size(other._size) {}
+
+  EncodedData& operator=(const EncodedData& other) {
+    _buf = other._buf;
+    _bytes = other._buf.empty() ? other._bytes : _buf.data();
+    _size = other._size;
+    return *this;
+  }
+
+  /*
+    バイト列の先頭を取得します。
+  */
+  const uint8_t* bytes() const noexcept {
+    return _bytes;
+  }
+
+  /*
+    バイト数を取得します。
+  */
+  size_t size() const noexcept {
+    return _size;
+  }
+
+  /*
+    保持しているバイト列をデシリアライズします。
+  */
+  Data toData() const {
+    Data data;
+    Data::deserialize(_bytes, _size, &data);
+    return data;
+  }
+};
+
+/*
+  一部の値だけを書き換えて送信するシリアライズ済みのデータです。
+  構築時に一度だけシリアライズし、bool、整数型、浮動小数点数型の値（数値配列とbool型の配列の要素を含む）の位置を記録します。
+  値は先頭から順に0, 1, 2, ...の番号で指定し、setメンバ関数でバイト列を直接書き換えます。
+  値のバイト数を変えないため、符号化方式は常にDataEncoding::Fixedになります。
+    EncodedTemplate frame({"telemetry", static_cast<uint32_t>(0), 0.0f});
+    frame.set(0, seq);     // static_cast<uint32_t>(0) の位置
+    frame.set(1, value);   // 0.0f の位置
+    wlTxWrite(frame);
+*/
+class EncodedTemplate : public EncodedData {
+private:
+  struct Field {
+    size_t offset;  // 値の位置（boolの場合は型の位置）
+    uint8_t type;   // 値の型（boolの場合はTYPE_TRUE）
+    uint8_t bit;    // bool型の配列の要素の場合はバイト内の位置
+  };
+
+  std::vector<Field> _fields;
+
+  template<class T>
+  bool _store(size_t field, uint8_t type, T val) {
+    if (field >= _fields.size() || _fields[field].type != type)
+      return false;
+    size_t off = _fields[field].offset;
+    serialize_float(_buf.data(), off, val);
+    return true;
+  }
+public:
+  explicit EncodedTemplate(const Data& data)
+    : EncodedData(data) {
+    const uint8_t* buf = _buf.data();
+    size_t size = _buf.size();
+    size_t off = 0;
+    while (off < size) {
+      uint8_t type = buf[off];
+      if (type == TYPE_TRUE || type == TYPE_FALSE) {
+        _fields.push_back({ off, TYPE_TRUE, 0 });
+        off += 1;
+      } else if (type == TYPE_STRING) {
+        off += 1;
+        off += deserialize_int<uint16_t>(buf, off);
+      } else if (type == TYPE_ARRAY) {
+        off += 1 + 2;
+      } else if (TYPE_INT8 <= type && type <= TYPE_UINT64) {
+        _fields.push_back({ off + 1, type, 0 });
+        off += 1 + (1 << ((type - TYPE_INT8) & 3));
+      } else if (TYPE_INT8_ARRAY <= type && type <= TYPE_UINT64_ARRAY) {
+        off += 1;
+        uint16_t len = deserialize_int<uint16_t>(buf, off);
+        size_t width = 1 << ((type - TYPE_INT8_ARRAY) & 3);
+        for (uint16_t i = 0; i < len; ++i, off += width)
+          _fields.push_back({ off, static_cast<uint8_t>(type - (TYPE_INT8_ARRAY - TYPE_INT8)), 0 });
+      } else if (type == TYPE_FLOAT32 || type == TYPE_FLOAT64) {
+        _fields.push_back({ off + 1, type, 0 });
+        off += 1 + (type == TYPE_FLOAT32 ? 4 : 8);
+      } else if (type == TYPE_BOOL_ARRAY) {
+        off += 1;
+        uint16_t len = deserialize_int<uint16_t>(buf, off);
+        for (uint16_t i = 0; i < len; ++i)
+          _fields.push_back({ off + (i >> 3), TYPE_BOOL_ARRAY, static_cast<uint8_t>(i & 7) });
+        off += (len + 7) >> 3;
+      } else if (type == TYPE_TIME_SERIES) {
+        // 圧縮された値は書き換えられないため読み飛ばします。
+        off += 1 + 1 + 2;
+        off += deserialize_int<uint16_t>(buf, off);
+      } else
+        off += 1;
+    }
+  }
+
+  /*
+    書き換えられる値の数を取得します。
+  */
+  size_t fieldCount() const noexcept {
+    return _fields.size();
+  }
+
+  /*
+    値を書き換えます。
+    番号が範囲外の場合や値の型が構築時と異なる場合はfalseを返します。
+  */
+  template<class IntType, typename std::enable_if<std::is_integral<IntType>::value && !std::is_same<IntType, bool>::value, int>::type = 0>
+  bool set(size_t field, IntType val) {
+    if (field >= _fields.size() || _fields[field].type != DataIntTags<IntType>::fixed)
+      return false;
+    size_t off = _fields[field].offset;
+    serialize_int(_buf.data(), off, val);
+    return true;
+  }
+
+  bool set(size_t field, bool val) {
+    if (field >= _fields.size())
+      return false;
+    const Field& f = _fields[field];
+    if (f.type == TYPE_TRUE)
+      _buf[f.offset] = val ? TYPE_TRUE : TYPE_FALSE;
+    else if (f.type == TYPE_BOOL_ARRAY)
+      _buf[f.offset] = val ? _buf[f.offset] | (1 << f.bit) : _buf[f.offset] & ~(1 << f.bit);
+    else
+      return false;
+    return true;
+  }
+
+  bool set(size_t field, float val) {
+    return _store(field, TYPE_FLOAT32, val);
+  }
+
+  bool set(size_t field, double val) {
+    return _store(field, TYPE_FLOAT64, val);
+  }
+};
+
+#endif
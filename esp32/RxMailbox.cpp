@@ -0,0 +1,77 @@
+#include "RxMailbox.hpp"
+
+RxMailbox::RxMailbox()
+  : _current(0), _version(0), _read(0), _dropped(0) {
+  for (Slot& slot : _slots) {
+    slot.readers.store(0, std::memory_order_relaxed);
+    slot.version = 0;
+  }
+}
+
+/*
+  最新のスロットの読み出し中の数を増やして返します。
+  増やした後も最新のままであれば、格納側はそのスロットに書き込みません。
+  （格納側のスロットの切り替えと読み出し中の数の確認に対して、順序を保証するためにseq_cstを使用します）
+*/
+RxMailbox::Slot& RxMailbox::_pin() noexcept {
+  for (;;) {
+    uint8_t index = _current.load(std::memory_order_seq_cst);
+    Slot& slot = _slots[index];
+    slot.readers.fetch_add(1, std::memory_order_seq_cst);
+    if (_current.load(std::memory_order_seq_cst) == index)
+      return slot;
+    slot.readers.fetch_sub(1, std::memory_order_release);
+  }
+}
+
+// 最新の値をdata_pに複製し、そのバージョンを返します。
+uint32_t RxMailbox::_copy(Data* const data_p) noexcept {
+  Slot& slot = _pin();
+  Data value = slot.value;
+  uint32_t version = slot.version;
+  slot.readers.fetch_sub(1, std::memory_order_release);
+  // data_pの古い値はスロットを解放してから解放します。
+  *data_p = std::move(value);
+  return version;
+}
+
+void RxMailbox::store(Data& data) noexcept {
+  uint8_t current = _current.load(std::memory_order_relaxed);
+  // 最も古い値を格納しているスロットから順に、読み出し中でないスロットを探します。
+  for (uint8_t i = 1; i < SLOTS; ++i) {
+    Slot& slot = _slots[(current + i) % SLOTS];
+    if (slot.readers.load(std::memory_order_seq_cst) != 0)
+      continue;
+    uint32_t version = _version.load(std::memory_order_relaxed);
+    std::swap(slot.value, data);
+    slot.version = version + 1;
+    _current.store((current + i) % SLOTS, std::memory_order_seq_cst);
+    if (_read.load(std::memory_order_relaxed) != version)
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+    _version.store(version + 1, std::memory_order_release);
+    return;
+  }
+  _dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool RxMailbox::take(Data* const data_p) noexcept {
+  if (!fresh())
+    return false;
+  Data value;
+  uint32_t version = _copy(&value);
+  // 他の読み出し側が同じかより新しい値を取り出した場合は取り出しません。
+  uint32_t read = _read.load(std::memory_order_acquire);
+  do {
+    if (static_cast<int32_t>(read - version) >= 0)
+      return false;
+  } while (!_read.compare_exchange_weak(read, version, std::memory_order_acq_rel, std::memory_order_acquire));
+  *data_p = std::move(value);
+  return true;
+}
+
+uint32_t RxMailbox::latest(Data* const data_p) noexcept {
+  uint32_t version = _copy(data_p);
+  uint32_t read = _read.load(std::memory_order_acquire);
+  while (static_cast<int32_t>(version - read) > 0 && !_read.compare_exchange_weak(read, version, std::memory_order_acq_rel, std::memory_order_acquire)) {}
+  return version;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#ifndef RX_MAILBOX
+#define RX_MAILBOX
+
+#include <atomic>
+
+#include "Data.hpp"
+
+/*
+  最新の値だけを保持する受信チャンネルの格納先です。
+  新しい値は古い値を上書きし、格納した回数をバージョンとして記録します。
+  値は複数のスロットに順に格納し、最新のスロットの番号を原子的に切り替えるため、格納と取り出しはロックせずに行います。
+  読み出し側は最新のスロットの読み出し中の数を増やしてから複製し、格納側は読み出し中でないスロットにだけ書き込みます。
+  上書きした古い値はstoreの引数と交換して返すため、次のデシリアライズでその領域を再利用できます。
+*/
+class RxMailbox {
+private:
+  // スロットの数（最新の値と、読み出し中の値の数より多く必要です）
+  static const constexpr uint8_t SLOTS = 4;
+
+  struct Slot {
+    std::atomic<uint32_t> readers;  // 複製している読み出し側の数
+    uint32_t version;               // 格納したときのバージョン
+    Data value;
+  };
+
+  Slot _slots[SLOTS];
+  std::atomic<uint8_t> _current;  // 最新の値を格納したスロット
+  std::atomic<uint32_t> _version;  // 格納した回数（0の場合は未受信）
+  std::atomic<uint32_t> _read;     // 最後に取り出した値のバージョン
+  std::atomic<size_t> _dropped;    // 取り出される前に上書きされた値の数
+
+  Slot& _pin() noexcept;
+  uint32_t _copy(Data* const /* data_p */) noexcept;
+public:
+  RxMailbox();
+
+  RxMailbox(const RxMailbox&) = delete;
+  RxMailbox& operator=(const RxMailbox&) = delete;
+
+  /*
+    値を格納し、dataには上書きした古い値を格納します。
+    すべてのスロットが読み出し中の場合は待たずに新しい値を破棄し、破棄した値の数に加えます。
+  */
+  void store(Data& /* data */) noexcept;
+
+  /*
+    まだ取り出していない値があれば、data_pに複製してtrueを返します。
+  */
+  bool take(Data* const /* data_p */) noexcept;
+
+  /*
+    取り出し済みかどうかに関わらず最新の値をdata_pに複製し、そのバージョンを返します。
+    値を受信していない場合は0を返します。
+  */
+  uint32_t latest(Data* const /* data_p */) noexcept;
+
+  /*
+    まだ取り出していない値があればtrueを返します。
+  */
+  bool fresh() const noexcept {
+    return _version.load(std::memory_order_acquire) != _read.load(std::memory_order_acquire);
+  }
+
+  /*
+    取り出される前に上書きされた値の数を取得し、0に戻します。
+  */
+  size_t dropped() noexcept {
+    return _dropped.exchange(0, std::memory_order_relaxed);
+  }
+};
+
+#endif
@@ -0,0 +1,66 @@
+#include "RxQueue.hpp"
+
+RxQueue::RxQueue(size_t capacity, RxOverflow overflow, size_t max_bytes, uint32_t timeout_ms)
+  : _ring(capacity), _capacity(capacity == 0 ? 1 : capacity), _max_bytes(max_bytes), _overflow(overflow), _timeout(pdMS_TO_TICKS(timeout_ms)), _dropped(0), _waiting(false),
+    _space(overflow == RxOverflow::Block ? xSemaphoreCreateBinary() : nullptr) {}
+
+RxQueue::~RxQueue() {
+  if (_space != nullptr)
+    vSemaphoreDelete(_space);
+}
+
+bool RxQueue::_tryPush(Data& data, size_t bytes) noexcept {
+  // DataRingの容量は2のべき乗なので、指定されたデータ数はここで制限します。
+  if (_ring.size() >= _capacity)
+    return false;
+  if (_max_bytes != 0 && _ring.bytes() + bytes > _max_bytes)
+    return false;
+  return _ring.push(data, bytes);
+}
+
+bool RxQueue::push(Data& data, size_t bytes) {
+  // 空のキューにも格納できないデータは待たずに破棄します。
+  if (_max_bytes != 0 && bytes > _max_bytes) {
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  TickType_t start = xTaskGetTickCount();
+  for (;;) {
+    if (_tryPush(data, bytes))
+      return true;
+    if (_overflow == RxOverflow::DropOldest) {
+      Data oldest;
+      if (_ring.pop(&oldest))
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    if (_overflow == RxOverflow::Block && _space != nullptr && elapsed < _timeout) {
+      // 登録してから再度確認することで、登録前に取り出された場合も待ち続けないようにします。
+      _waiting.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (_tryPush(data, bytes)) {
+        _waiting.store(false, std::memory_order_relaxed);
+        return true;
+      }
+      // タイムアウトした後に与えられたセマフォで次の待機がすぐに終わることがありますが、再度確認して待ち直します。
+      xSemaphoreTake(_space, _timeout - elapsed);
+      _waiting.store(false, std::memory_order_relaxed);
+      continue;
+    }
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+}
+
+bool RxQueue::pop(Data* const data_p) noexcept {
+  if (!_ring.pop(data_p))
+    return false;
+  if (_overflow != RxOverflow::Block)
+    return true;
+  // 待つ側の登録と確認の順序に対して、取り出しと確認の順序を保証します。
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (_waiting.load(std::memory_order_relaxed) && _waiting.exchange(false, std::memory_order_acq_rel))
+    xSemaphoreGive(_space);
+  return true;
+}
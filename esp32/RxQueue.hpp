@@ -0,0 +1,88 @@
+#pragma once
+
+#ifndef RX_QUEUE
+#define RX_QUEUE
+
+#include <Arduino.h>
+
+#include <atomic>
+
+#include "Data.hpp"
+#include "DataRing.hpp"
+
+/*
+  受信キューが満杯のときの動作を表す列挙型
+*/
+enum class RxOverflow : uint8_t {
+  DropNewest,  // 新しく受信したデータを破棄します
+  DropOldest,  // 最も古いデータを破棄して、新しく受信したデータを格納します
+  Block        // 空きができるまで受信タスクを待たせ、タイムアウトした場合は新しく受信したデータを破棄します
+};
+
+/*
+  データ数とバイト数の上限をもつ受信キューです。
+  上限は構築時に決まり、格納するデータが増えてもメモリの使用量は上限を超えません。
+  上限を超える場合はRxOverflowで指定した動作を行い、破棄したデータ数を記録します。
+*/
+class RxQueue {
+private:
+  DataRing _ring;
+  size_t _capacity;      // データ数の上限
+  size_t _max_bytes;     // バイト数の上限（0の場合は制限しません）
+  RxOverflow _overflow;
+  TickType_t _timeout;   // Blockの場合に待つ最大のティック数
+  std::atomic<size_t> _dropped;
+  std::atomic<bool> _waiting;  // 受信タスクが空きを待っているか
+  /*
+    空きができたことを受信タスクに知らせるセマフォ
+    受信タスクのタスク通知はアプリケーションや他のライブラリが使用する可能性があるため使用しません。
+  */
+  SemaphoreHandle_t _space;
+
+  bool _tryPush(Data& /* data */, size_t /* bytes */) noexcept;
+public:
+  /*
+    データ数の上限、満杯のときの動作、バイト数の上限、Blockの場合のタイムアウト（ミリ秒）を指定して構築します。
+    データ数の上限が0の場合は1として扱います。
+  */
+  explicit RxQueue(size_t /* capacity */, RxOverflow /* overflow */ = RxOverflow::DropNewest, size_t /* max_bytes */ = 0, uint32_t /* timeout_ms */ = 0);
+  RxQueue(const RxQueue&) = delete;
+  RxQueue& operator=(const RxQueue&) = delete;
+  ~RxQueue();
+
+  /*
+    受信したデータを追加します。
+    bytesには受信したバイト数を指定します。
+    破棄した場合はfalseを返します（DropOldestで古いデータを破棄した場合はtrueを返します）。
+  */
+  bool push(Data& /* data */, size_t /* bytes */);
+
+  /*
+    先頭のデータを取り出します。
+    キューが空の場合はfalseを返します。
+  */
+  bool pop(Data* const /* data_p */) noexcept;
+
+  /*
+    格納されているデータ数を取得します。
+  */
+  size_t size() const noexcept {
+    return _ring.size();
+  }
+
+  /*
+    格納されているデータのバイト数の合計を取得します。
+  */
+  size_t bytes() const noexcept {
+    return _ring.bytes();
+  }
+
+  /*
+    破棄したデータ数を取得し、0に戻します。
+  */
+  size_t dropped() noexcept {
+    return _dropped.exchange(0, std::memory_order_relaxed);
+  }
+};
+
+#endif
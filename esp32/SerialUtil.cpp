@@ -1,73 +1,89 @@
 #include "HardwareSerial.h"
 #include "SerialUtil.hpp"
 
-static const constexpr uint16_t MAX_PACKET_SIZE = 256;           // 送受信可能な最大バイト数
+#include <mutex>
+
+static const constexpr uint16_t STACK_PACKET_SIZE = 256;         // スタック上のバッファでシリアライズする最大バイト数
+static const constexpr uint16_t MAX_PACKET_SIZE = 4096;          // 送信可能な最大バイト数（PacketSerialはエンコード用のバッファをスタック上に確保します）
 static const constexpr uint32_t RECEIVE_TASK_STACK_SIZE = 4096;  // 受信タスクのスタックメモリサイズ
 static const constexpr UBaseType_t RECEIVE_TASK_PRIORITY = 5;    // 受信タスクの優先度
 static const constexpr BaseType_t RECEIVE_TASK_CORE = 1;         // 受信タスクを実行するコア
 
-static TaskHandle_t task_handle;
+static volatile TaskHandle_t task_handle = nullptr;
 static PacketSerial packetSerial;
-static std::queue<Data> rx_buf;  // 受信バッファ
-static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
-static volatile bool mux_flag = false;
+static RxQueue rx_buf(SERIAL_RX_QUEUE_SIZE, SERIAL_RX_OVERFLOW, SERIAL_RX_QUEUE_BYTES, SERIAL_RX_TIMEOUT);  // 受信バッファ（受信タスクからロックせずに追加します）
+static std::mutex tx_mutex;                    // 送信するパケットが混ざらないように排他します
+static std::mutex config_mutex;                // 開始と終了を排他します
 static volatile bool run_flag = false;
 static volatile bool default_serial_flag = false;
-static inline void mutEnter() {
-  for (;;) {
-    bool got;
-    portENTER_CRITICAL(&mux);
-    if (!mux_flag) {
-      mux_flag = true;
-      got = true;
-    } else
-      got = false;
-    portEXIT_CRITICAL(&mux);
-    if (got)
-      return;
-    delay(1);
+
+static bool sendPacket(const uint8_t* buf, size_t size) {
+  std::lock_guard<std::mutex> lock(tx_mutex);
+  packetSerial.send(buf, size);
+  return true;
+}
+
+bool serialWrite(const Data& data, DataEncoding encoding) {
+  size_t size = data.serializedSize(encoding);
+  if (size == 0 || size > MAX_PACKET_SIZE)
+    return false;
+  if (size <= STACK_PACKET_SIZE) {
+    uint8_t buf[STACK_PACKET_SIZE];
+    return data.serialize(buf, size, encoding) == size && sendPacket(buf, size);
   }
+  std::vector<uint8_t> buf;
+  buf.reserve(size);
+  return data.serialize(buf, encoding) == size && sendPacket(buf.data(), size);
 }
-static inline void mutExit() {
-  portENTER_CRITICAL(&mux);
-  mux_flag = false;
-  portEXIT_CRITICAL(&mux);
+
+bool serialWrite(const EncodedData& data) {
+  return data.size() != 0 && data.size() <= MAX_PACKET_SIZE && sendPacket(data.bytes(), data.size());
 }
 
-void serialWrite(const Data& data) {
-  uint8_t buf[MAX_PACKET_SIZE];
-  size_t size = data.serialize(buf, MAX_PACKET_SIZE);
-  if (size == 0) return;
-  mutEnter();
-  packetSerial.send(buf, size);
-  mutExit();
+bool serialWrite(size_t (*sizer)(const void*, DataEncoding), size_t (*serializer)(const void*, uint8_t*, size_t, DataEncoding), const void* value, DataEncoding encoding) {
+  size_t size = sizer(value, encoding);
+  if (size == 0 || size > MAX_PACKET_SIZE)
+    return false;
+  if (size <= STACK_PACKET_SIZE) {
+    uint8_t buf[STACK_PACKET_SIZE];
+    return serializer(value, buf, size, encoding) == size && sendPacket(buf, size);
+  }
+  std::vector<uint8_t> heap_buf(size);
+  return serializer(value, heap_buf.data(), size, encoding) == size && sendPacket(heap_buf.data(), size);
 }
 
+/*
+  受信タスクはキューへの追加の途中で削除されないように、run_flagがfalseになると自身を削除します。
+  送信はストリームへの書き込みだけを行うため、受信とは排他しません。
+*/
 static void serialReceiveTask(void*) {
-  for (;;) {
-    mutEnter();
+  while (run_flag) {
     packetSerial.update();
-    mutExit();
     delay(1);
   }
+  task_handle = nullptr;
+  vTaskDelete(nullptr);
 }
 
 static void packetHandler(const uint8_t* buf, size_t size) {
   Data data;
+  // 満杯の場合はSERIAL_RX_OVERFLOWに従います。
   if (Data::deserialize(buf, size, &data))
-    rx_buf.push(data);
+    rx_buf.push(data, size);
 }
 
 static void initPacketSerial(Stream& stream) {
   run_flag = true;
   packetSerial.setStream(&stream);
   packetSerial.setPacketHandler(packetHandler);
-  xTaskCreatePinnedToCore(serialReceiveTask, "serialReceiveTask", RECEIVE_TASK_STACK_SIZE, nullptr, RECEIVE_TASK_PRIORITY, &task_handle, RECEIVE_TASK_CORE);
+  TaskHandle_t handle;
+  xTaskCreatePinnedToCore(serialReceiveTask, "serialReceiveTask", RECEIVE_TASK_STACK_SIZE, nullptr, RECEIVE_TASK_PRIORITY, &handle, RECEIVE_TASK_CORE);
+  task_handle = handle;
 }
 
 bool serialBegin() {
   bool res;
-  mutEnter();
+  std::lock_guard<std::mutex> lock(config_mutex);
   if (run_flag)
     res = false;
   else {
@@ -76,55 +92,48 @@ bool serialBegin() {
     Serial.begin(9600);
     initPacketSerial(Serial);
   }
-  mutExit();
   return res;
 }
 
 bool serialBegin(Stream& stream) {
   bool res;
-  mutEnter();
+  std::lock_guard<std::mutex> lock(config_mutex);
   if (run_flag)
     res = false;
   else {
     res = true;
     initPacketSerial(stream);
   }
-  mutExit();
   return res;
 }
 
 bool serialEnd() {
   bool res;
-  mutEnter();
+  std::lock_guard<std::mutex> lock(config_mutex);
   if (run_flag) {
     res = true;
-    vTaskDelete(task_handle);
+    // 受信タスクが終了するまで待ちます。
     run_flag = false;
+    while (task_handle != nullptr)
+      delay(1);
     if (default_serial_flag) Serial.end();
     default_serial_flag = false;
   } else
     res = false;
-  mutExit();
   return res;
 }
 
 size_t serialAvailable() {
-  size_t s;
-  mutEnter();
-  s = rx_buf.size();
-  mutExit();
-  return s;
+  return rx_buf.size();
+}
+
+size_t serialDropped() {
+  return rx_buf.dropped();
 }
 
 Data serialRead() {
   Data data;
-  mutEnter();
-  if (rx_buf.empty())
+  if (!rx_buf.pop(&data))
     data = nullptr;
-  else {
-    data = rx_buf.front();
-    rx_buf.pop();
-  }
-  mutExit();
   return data;
 }
\ No newline at end of file
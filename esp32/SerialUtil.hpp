@@ -4,12 +4,48 @@
 #define SERIAL_UTIL
 
 #include "Data.hpp"
+#include "DataStruct.hpp"
+#include "EncodedData.hpp"
+#include "RxQueue.hpp"
 
 #include <unordered_map>
 #include <queue>
 #include <PacketSerial.h>
 
-void serialWrite(const Data&);
+#ifndef SERIAL_RX_QUEUE_SIZE
+// 受信バッファに格納できるデータ数
+#define SERIAL_RX_QUEUE_SIZE 32
+#endif
+
+#ifndef SERIAL_RX_QUEUE_BYTES
+// 受信バッファに格納できる受信したバイト数の合計（0の場合は制限しません）
+#define SERIAL_RX_QUEUE_BYTES 0
+#endif
+
+#ifndef SERIAL_RX_OVERFLOW
+// 受信バッファが満杯のときの動作
+#define SERIAL_RX_OVERFLOW RxOverflow::DropNewest
+#endif
+
+#ifndef SERIAL_RX_TIMEOUT
+// SERIAL_RX_OVERFLOWがRxOverflow::Blockの場合に受信タスクを待たせる最大の時間（ミリ秒）
+#define SERIAL_RX_TIMEOUT 0
+#endif
+
+bool serialWrite(const Data&, DataEncoding = DataEncoding::Fixed);
+
+bool serialWrite(const EncodedData&);
+
+bool serialWrite(size_t (*)(const void*, DataEncoding), size_t (*)(const void*, uint8_t*, size_t, DataEncoding), const void*, DataEncoding = DataEncoding::Fixed);
+
+template<class T, class = decltype(DataStruct<T>::members())>
+bool serialWrite(const T& value, DataEncoding encoding = DataEncoding::Fixed) {
+  return serialWrite([](const void* v, DataEncoding e) {
+    return serializedSizeStruct(*static_cast<const T*>(v), e);
+  }, [](const void* v, uint8_t* buf, size_t size, DataEncoding e) {
+    return serializeStruct(*static_cast<const T*>(v), buf, size, e);
+  }, &value, encoding);
+}
 
 bool serialBegin();
 
@@ -19,6 +55,8 @@ bool serialEnd();
 
 size_t serialAvailable();
 
+size_t serialDropped();
+
 Data serialRead();
 
 #endif
\ No newline at end of file
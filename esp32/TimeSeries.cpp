@@ -0,0 +1,303 @@
+#include "TimeSeries.hpp"
+#include "DataCodec.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+// 一つの組を書き込むときの最大のビット数（時刻 4 + 32、値 2 + 5 + 6 + 64）
+static const constexpr size_t MAX_SAMPLE_BITS = 4 + 32 + 2 + 5 + 6 + 64;
+// 時系列の要素数と圧縮したバイト数の前に書き込む値の型、要素数、バイト数のバイト数
+static const constexpr size_t HEADER_SIZE = 1 + 2 + 2;
+
+/*
+  時刻の差の差と整数値の差は、ZigZag符号化した値の大きさに応じて次のビット列で書き込みます。
+    0                : 0
+    10   + widths[0] : 2^widths[0]未満
+    110  + widths[1] : 2^widths[1]未満
+    1110 + widths[2] : 2^widths[2]未満
+    1111 + widths[3] : それ以外
+*/
+static const constexpr uint8_t TIME_WIDTHS[4] = { 7, 9, 12, 32 };
+static const constexpr uint8_t INT_WIDTHS[4] = { 8, 16, 32, 64 };
+
+// XORの上位の0のビット数を書き込むビット数
+static const constexpr uint8_t LEADING_BITS = 5;
+
+// XORの有効なビット数から1を引いた値を書き込むビット数
+static uint8_t length_bits(uint8_t width) noexcept {
+  return width == 64 ? 6 : 5;
+}
+
+TimeSeriesEncoder::TimeSeriesEncoder(TimeSeriesType type)
+  : _type(type) {
+  reset();
+}
+
+void TimeSeriesEncoder::reset() noexcept {
+  _bytes.clear();
+  _bits = 0;
+  _count = 0;
+  _time = 0;
+  _delta = 0;
+  _value = 0;
+  _leading = 0xFF;
+  _trailing = 0;
+}
+
+bool TimeSeriesEncoder::_full() const noexcept {
+  return _count == 0xFFFF || (_bits + MAX_SAMPLE_BITS + 7) >> 3 > 0xFFFF;
+}
+
+void TimeSeriesEncoder::_write(uint64_t bits, uint8_t n) {
+  // 上位のビットから順に、バイトの上位のビットへ詰めて書き込みます。
+  while (n > 0) {
+    size_t used = _bits & 7;
+    if (used == 0)
+      _bytes.push_back(0);
+    uint8_t take = std::min<uint8_t>(8 - used, n);
+    uint8_t chunk = (bits >> (n - take)) & ((1 << take) - 1);
+    _bytes.back() |= chunk << (8 - used - take);
+    _bits += take;
+    n -= take;
+  }
+}
+
+void TimeSeriesEncoder::_writeBucket(uint64_t val, const uint8_t* widths) {
+  if (val == 0) {
+    _write(0b0, 1);
+    return;
+  }
+  uint8_t i = 0;
+  while (i < 3 && val >> widths[i] != 0)
+    ++i;
+  // 1をi + 1個と、i < 3の場合は続けて0を書き込みます（10, 110, 1110, 1111）。
+  _write(i < 3 ? (1 << (i + 2)) - 2 : 0b1111, i < 3 ? i + 2 : 4);
+  _write(val, widths[i]);
+}
+
+void TimeSeriesEncoder::_writeTime(uint32_t time) {
+  if (_count == 0) {
+    _write(time, 32);
+    _time = time;
+    return;
+  }
+  // millis()が一周しても差が正しく求まるように、32bitの符号なし整数のまま計算します。
+  uint32_t delta = time - _time;
+  uint32_t dod = delta - _delta;
+  _writeBucket(static_cast<uint32_t>(zigzag_encode(static_cast<int32_t>(dod))), TIME_WIDTHS);
+  _time = time;
+  _delta = delta;
+}
+
+void TimeSeriesEncoder::_writeXor(uint64_t value, uint8_t width) {
+  if (_count == 0) {
+    _write(value, width);
+    _value = value;
+    return;
+  }
+  uint64_t x = value ^ _value;
+  _value = value;
+  if (x == 0) {
+    _write(0b0, 1);
+    return;
+  }
+  uint8_t leading = std::min<uint8_t>(__builtin_clzll(x) - (64 - width), (1 << LEADING_BITS) - 1);
+  uint8_t trailing = __builtin_ctzll(x);
+  if (_leading != 0xFF && leading >= _leading && trailing >= _trailing) {
+    // 前のXORと同じ範囲に収まる場合は、範囲だけを書き込みます。
+    _write(0b10, 2);
+    _write(x >> _trailing, width - _leading - _trailing);
+    return;
+  }
+  uint8_t len = width - leading - trailing;
+  _write(0b11, 2);
+  _write(leading, LEADING_BITS);
+  _write(len - 1, length_bits(width));
+  _write(x >> trailing, len);
+  _leading = leading;
+  _trailing = trailing;
+}
+
+bool TimeSeriesEncoder::append(uint32_t time, float value) {
+  if (_type != TimeSeriesType::Float32 || _full())
+    return false;
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  _writeTime(time);
+  _writeXor(bits, 32);
+  ++_count;
+  return true;
+}
+
+bool TimeSeriesEncoder::append(uint32_t time, double value) {
+  if (_type != TimeSeriesType::Float64 || _full())
+    return false;
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  _writeTime(time);
+  _writeXor(bits, 64);
+  ++_count;
+  return true;
+}
+
+bool TimeSeriesEncoder::_appendInt(uint32_t time, int64_t value) {
+  if (_type != TimeSeriesType::Int64 || _full())
+    return false;
+  _writeTime(time);
+  // 最初の値は0との差として書き込みます。
+  uint64_t delta = static_cast<uint64_t>(value) - _value;
+  _writeBucket(zigzag_encode(static_cast<int64_t>(delta)), INT_WIDTHS);
+  _value = static_cast<uint64_t>(value);
+  ++_count;
+  return true;
+}
+
+Data TimeSeriesEncoder::toData() const {
+  std::vector<uint8_t> payload(HEADER_SIZE + _bytes.size());
+  size_t off = 0;
+  payload[off++] = static_cast<uint8_t>(_type);
+  serialize_int(payload.data(), off, _count);
+  serialize_int(payload.data(), off, static_cast<uint16_t>(_bytes.size()));
+  if (!_bytes.empty())
+    memcpy(payload.data() + off, _bytes.data(), _bytes.size());
+  Data data;
+  data._initEncoded(DataType::TimeSeries, payload.data(), payload.size());
+  return data;
+}
+
+TimeSeriesDecoder::TimeSeriesDecoder(const Data& data)
+  : _data(data) {
+  size_t len;
+  const uint8_t* payload = _data._encoded(DataType::TimeSeries, len);
+  _init(payload, len);
+}
+
+TimeSeriesDecoder::TimeSeriesDecoder(const DataView& view) {
+  if (view.type() == DataType::TimeSeries)
+    _init(view._payload(), view.encodedSize() - 1);
+  else
+    _init(nullptr, 0);
+}
+
+void TimeSeriesDecoder::_init(const uint8_t* payload, size_t len) noexcept {
+  _bit = 0;
+  _index = 0;
+  _time = 0;
+  _delta = 0;
+  _value = 0;
+  _leading = 0xFF;
+  _trailing = 0;
+  if (payload == nullptr || len < HEADER_SIZE) {
+    _bytes = nullptr;
+    _size = 0;
+    _type = TimeSeriesType::Float32;
+    _count = 0;
+    return;
+  }
+  size_t off = 0;
+  _type = static_cast<TimeSeriesType>(payload[off++]);
+  _count = deserialize_int<uint16_t>(payload, off);
+  _size = std::min<size_t>(deserialize_int<uint16_t>(payload, off), len - HEADER_SIZE);
+  _bytes = payload + off;
+}
+
+bool TimeSeriesDecoder::_read(uint8_t n, uint64_t& bits) noexcept {
+  if (_bit + n > _size << 3)
+    return false;
+  bits = 0;
+  while (n > 0) {
+    size_t used = _bit & 7;
+    uint8_t take = std::min<uint8_t>(8 - used, n);
+    uint8_t chunk = (_bytes[_bit >> 3] >> (8 - used - take)) & ((1 << take) - 1);
+    bits = bits << take | chunk;
+    _bit += take;
+    n -= take;
+  }
+  return true;
+}
+
+bool TimeSeriesDecoder::_readBucket(uint64_t& val, const uint8_t* widths) noexcept {
+  // 先頭の1の数（最大4）でビット数を判別します。
+  uint8_t ones = 0;
+  uint64_t bit;
+  while (ones < 4) {
+    if (!_read(1, bit)) return false;
+    if (bit == 0) break;
+    ++ones;
+  }
+  val = 0;
+  return ones == 0 || _read(widths[ones - 1], val);
+}
+
+bool TimeSeriesDecoder::_readTime(uint32_t* const time_p) noexcept {
+  uint64_t bits;
+  if (_index == 0) {
+    if (!_read(32, bits)) return false;
+    _time = bits;
+  } else {
+    if (!_readBucket(bits, TIME_WIDTHS)) return false;
+    _delta += static_cast<uint32_t>(zigzag_decode<int32_t>(bits));
+    _time += _delta;
+  }
+  *time_p = _time;
+  return true;
+}
+
+bool TimeSeriesDecoder::_readXor(uint8_t width) noexcept {
+  uint64_t bits;
+  if (_index == 0) {
+    if (!_read(width, bits)) return false;
+    _value = bits;
+    return true;
+  }
+  if (!_read(1, bits)) return false;
+  if (bits == 0)
+    return true;
+  if (!_read(1, bits)) return false;
+  if (bits == 0) {
+    if (_leading == 0xFF || !_read(width - _leading - _trailing, bits)) return false;
+    _value ^= bits << _trailing;
+    return true;
+  }
+  uint64_t leading, len;
+  if (!_read(LEADING_BITS, leading) || !_read(length_bits(width), len)) return false;
+  ++len;
+  if (leading + len > width) return false;
+  if (!_read(len, bits)) return false;
+  _leading = leading;
+  _trailing = width - leading - len;
+  _value ^= bits << _trailing;
+  return true;
+}
+
+bool TimeSeriesDecoder::_readInt() noexcept {
+  uint64_t bits;
+  if (!_readBucket(bits, INT_WIDTHS)) return false;
+  _value += static_cast<uint64_t>(zigzag_decode<int64_t>(bits));
+  return true;
+}
+
+bool TimeSeriesDecoder::next(uint32_t* const time_p, float* const value_p) noexcept {
+  if (_type != TimeSeriesType::Float32 || _index >= _count || !_readTime(time_p) || !_readXor(32))
+    return false;
+  uint32_t bits = _value;
+  memcpy(value_p, &bits, sizeof(bits));
+  ++_index;
+  return true;
+}
+
+bool TimeSeriesDecoder::next(uint32_t* const time_p, double* const value_p) noexcept {
+  if (_type != TimeSeriesType::Float64 || _index >= _count || !_readTime(time_p) || !_readXor(64))
+    return false;
+  memcpy(value_p, &_value, sizeof(_value));
+  ++_index;
+  return true;
+}
+
+bool TimeSeriesDecoder::next(uint32_t* const time_p, int64_t* const value_p) noexcept {
+  if (_type != TimeSeriesType::Int64 || _index >= _count || !_readTime(time_p) || !_readInt())
+    return false;
+  *value_p = static_cast<int64_t>(_value);
+  ++_index;
+  return true;
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#ifndef TIME_SERIES
+#define TIME_SERIES
+
+#include <type_traits>
+#include <vector>
+
+#include "Data.hpp"
+#include "DataView.hpp"
+
+/*
+  時刻と値の組を圧縮して時系列のデータを構築するクラスです。
+  時刻は前の時刻の差の差（delta-of-delta）を、値はfloatとdoubleは前の値とのXORを、整数は前の値との差をそれぞれ可変長のビット列で書き込みます。
+  一定の間隔で記録した、ゆっくり変化する値ほど少ないバイト数になります。
+    TimeSeriesEncoder series(TimeSeriesType::Float32);
+    series.append(millis(), temperature);
+    if (series.count() == 64) {
+      wlTxWrite(series.toData());
+      series.reset();
+    }
+*/
+class TimeSeriesEncoder {
+private:
+  TimeSeriesType _type;
+  std::vector<uint8_t> _bytes;  // 圧縮したバイト列
+  size_t _bits;                 // 書き込んだビット数
+  uint16_t _count;              // 書き込んだ組の数
+  uint32_t _time;               // 前の時刻
+  uint32_t _delta;              // 前の時刻の差
+  uint64_t _value;              // 前の値のビット列
+  uint8_t _leading;             // 前に書き込んだXORの上位の0のビット数（書き込んでいない場合は0xFF）
+  uint8_t _trailing;            // 前に書き込んだXORの下位の0のビット数
+
+  void _write(uint64_t /* bits */, uint8_t /* n */);
+  void _writeBucket(uint64_t /* val */, const uint8_t* /* widths */);
+  void _writeTime(uint32_t /* time */);
+  void _writeXor(uint64_t /* value */, uint8_t /* width */);
+  bool _appendInt(uint32_t /* time */, int64_t /* value */);
+  bool _full() const noexcept;
+public:
+  /*
+    値の型を指定して構築します。
+  */
+  explicit TimeSeriesEncoder(TimeSeriesType /* type */ = TimeSeriesType::Float32);
+
+  /*
+    時刻とfloat型の値の組を追加します。
+    値の型がFloat32でない場合や、これ以上追加できない場合はfalseを返します。
+  */
+  bool append(uint32_t /* time */, float /* value */);
+
+  /*
+    時刻とdouble型の値の組を追加します。
+    値の型がFloat64でない場合や、これ以上追加できない場合はfalseを返します。
+  */
+  bool append(uint32_t /* time */, double /* value */);
+
+  /*
+    時刻と整数値の組を追加します。
+    値はint64_t型として扱います。
+    値の型がInt64でない場合や、これ以上追加できない場合はfalseを返します。
+  */
+  template<class IntType, typename std::enable_if<std::is_integral<IntType>::value && !std::is_same<IntType, bool>::value, int>::type = 0>
+  bool append(uint32_t time, IntType value) {
+    return _appendInt(time, static_cast<int64_t>(value));
+  }
+
+  /*
+    値の型を取得します。
+  */
+  TimeSeriesType type() const noexcept {
+    return _type;
+  }
+
+  /*
+    追加した組の数を取得します。
+  */
+  size_t count() const noexcept {
+    return _count;
+  }
+
+  /*
+    toData関数で構築したデータをシリアライズしたときのバイト数を取得します。
+    送信するパケットの大きさに合わせて区切る場合に使用します。
+  */
+  size_t encodedSize() const noexcept {
+    return 1 + 1 + 2 + 2 + _bytes.size();
+  }
+
+  /*
+    追加した組をもつ時系列のデータを構築します。
+  */
+  Data toData() const;
+
+  /*
+    追加した組をすべて削除します。
+    確保したバッファはそのまま再利用します。
+  */
+  void reset() noexcept;
+};
+
+/*
+  時系列のデータから時刻と値の組を先頭から順に読み出すクラスです。
+  DataViewから構築した場合は、参照するバッファを使用している間は解放しないでください。
+    TimeSeriesDecoder series(data);
+    uint32_t time;
+    float value;
+    while (series.next(&time, &value)) {
+      Serial.print(time);
+      Serial.print(": ");
+      Serial.println(value);
+    }
+*/
+class TimeSeriesDecoder {
+private:
+  Data _data;             // Dataから構築した場合に値を保持します
+  const uint8_t* _bytes;  // 圧縮したバイト列
+  size_t _size;           // 圧縮したバイト数
+  size_t _bit;            // 読み出したビット数
+  TimeSeriesType _type;
+  uint16_t _count;  // 組の数
+  uint16_t _index;  // 読み出した組の数
+  uint32_t _time;
+  uint32_t _delta;
+  uint64_t _value;
+  uint8_t _leading;
+  uint8_t _trailing;
+
+  void _init(const uint8_t* /* payload */, size_t /* len */) noexcept;
+  bool _read(uint8_t /* n */, uint64_t& /* bits */) noexcept;
+  bool _readBucket(uint64_t& /* val */, const uint8_t* /* widths */) noexcept;
+  bool _readTime(uint32_t* const /* time_p */) noexcept;
+  bool _readXor(uint8_t /* width */) noexcept;
+  bool _readInt() noexcept;
+public:
+  /*
+    時系列のデータから構築します。
+    データが時系列でない場合は組が1つもないものとして扱います。
+  */
+  explicit TimeSeriesDecoder(const Data&);
+
+  /*
+    シリアライズされた時系列のデータを参照して構築します。
+    データが時系列でない場合は組が1つもないものとして扱います。
+  */
+  explicit TimeSeriesDecoder(const DataView&);
+
+  /*
+    値の型を取得します。
+  */
+  TimeSeriesType type() const noexcept {
+    return _type;
+  }
+
+  /*
+    組の数を取得します。
+  */
+  size_t size() const noexcept {
+    return _count;
+  }
+
+  /*
+    次の時刻とfloat型の値の組を読み出します。
+    値の型がFloat32でない場合や、すべて読み出した場合、データが正しくない場合はfalseを返します。
+  */
+  bool next(uint32_t* const /* time_p */, float* const /* value_p */) noexcept;
+
+  /*
+    次の時刻とdouble型の値の組を読み出します。
+    値の型がFloat64でない場合や、すべて読み出した場合、データが正しくない場合はfalseを返します。
+  */
+  bool next(uint32_t* const /* time_p */, double* const /* value_p */) noexcept;
+
+  /*
+    次の時刻と整数値の組を読み出します。
+    値の型がInt64でない場合や、すべて読み出した場合、データが正しくない場合はfalseを返します。
+  */
+  bool next(uint32_t* const /* time_p */, int64_t* const /* value_p */) noexcept;
+};
+
+#endif
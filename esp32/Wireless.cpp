@@ -1,7 +1,13 @@
 #include "Wireless.hpp"
 
-// 送受信可能な最大バイト数
-static const constexpr uint16_t MAX_PACKET_SIZE = 256;
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+// スタック上のバッファでシリアライズする最大バイト数（これを超えるデータはヒープ上のバッファを使用します）
+static const constexpr uint16_t STACK_PACKET_SIZE = 256;
+// UDPで送信可能な最大バイト数
+static const constexpr size_t MAX_PACKET_SIZE = 65507;
 
 static AsyncUDP udp;
 
@@ -41,19 +47,113 @@ struct Address {
 };
 
 
+// シリアライズしたデータ
+class TxPacket {
+private:
+  uint8_t _stack_buf[STACK_PACKET_SIZE];
+  std::vector<uint8_t> _heap_buf;
+  const uint8_t *_bytes = nullptr;
+  size_t _size = 0;
+public:
+  // dictがnullptrでない場合は辞書を使用してシリアライズします。
+  bool serialize(const Data &data, DataEncoding encoding, DataDictionary *dict = nullptr) {
+    size_t size = dict != nullptr ? data.serializedSize(encoding, *dict) : data.serializedSize(encoding);
+    if (size == 0 || size > MAX_PACKET_SIZE)
+      return false;
+    if (size <= STACK_PACKET_SIZE) {
+      if ((dict != nullptr ? data.serialize(_stack_buf, size, encoding, *dict) : data.serialize(_stack_buf, size, encoding)) != size)
+        return false;
+      _bytes = _stack_buf;
+    } else {
+      _heap_buf.clear();
+      _heap_buf.reserve(size);
+      if ((dict != nullptr ? data.serialize(_heap_buf, encoding, *dict) : data.serialize(_heap_buf, encoding)) != size)
+        return false;
+      _bytes = _heap_buf.data();
+    }
+    _size = size;
+    return true;
+  }
+
+  bool serialized() const noexcept {
+    return _bytes != nullptr;
+  }
+
+  const uint8_t *bytes() const noexcept {
+    return _bytes;
+  }
+
+  size_t size() const noexcept {
+    return _size;
+  }
+};
+
 class TxChannel {
 private:
   std::vector<Address> _addresses;
+  DataEncoding _encoding = DataEncoding::Fixed;
+  std::unique_ptr<DataDictionary> _dictionary;  // 文字列を登録した場合に構築します
 public:
+  TxChannel() = default;
+
   TxChannel(IPAddress ip, uint16_t port)
     : _addresses{ Address{ ip, port } } {}
 
-  void send(const Data &data) {
-    uint8_t buf[MAX_PACKET_SIZE];
-    size_t size = data.serialize(buf, MAX_PACKET_SIZE);
-    if (size != 0)
-      for (const Address &address : _addresses)
-        udp.writeTo(buf, size, address.ip, address.port);
+  void setEncoding(DataEncoding encoding) {
+    _encoding = encoding;
+  }
+
+  DataEncoding encoding() const noexcept {
+    return _encoding;
+  }
+
+  DataDictionary &dictionary() {
+    if (!_dictionary)
+      _dictionary.reset(new DataDictionary());
+    return *_dictionary;
+  }
+
+  bool hasDictionary() const noexcept {
+    return _dictionary != nullptr;
+  }
+
+  const std::vector<Address> &addresses() const noexcept {
+    return _addresses;
+  }
+
+  bool contains(const Address &adr) const noexcept {
+    return std::find(_addresses.begin(), _addresses.end(), adr) != _addresses.end();
+  }
+
+  bool write(const uint8_t *buf, size_t size) {
+    bool sent = true;
+    for (const Address &address : _addresses)
+      if (udp.writeTo(buf, size, address.ip, address.port) != size)
+        sent = false;
+    return sent;
+  }
+
+  // シリアライズしたバイト数がUDPで送信できる範囲に収まるかを確認します。
+  bool fits(const Data &data) const noexcept {
+    size_t size = _dictionary ? data.serializedSize(_encoding, *_dictionary) : data.serializedSize(_encoding);
+    return size != 0 && size <= MAX_PACKET_SIZE;
+  }
+
+  bool send(const Data &data) {
+    TxPacket packet;
+    return packet.serialize(data, _encoding, _dictionary.get()) && write(packet.bytes(), packet.size());
+  }
+
+  bool send(size_t (*sizer)(const void *, DataEncoding), size_t (*serializer)(const void *, uint8_t *, size_t, DataEncoding), const void *value) {
+    size_t size = sizer(value, _encoding);
+    if (size == 0 || size > MAX_PACKET_SIZE)
+      return false;
+    if (size <= STACK_PACKET_SIZE) {
+      uint8_t buf[STACK_PACKET_SIZE];
+      return serializer(value, buf, size, _encoding) == size && write(buf, size);
+    }
+    std::vector<uint8_t> heap_buf(size);
+    return serializer(value, heap_buf.data(), size, _encoding) == size && write(heap_buf.data(), size);
   }
 
   void attach(IPAddress ip, uint16_t port) {
@@ -61,6 +161,9 @@ public:
     for (const Address &address : _addresses)
       if (address == adr) return;
     _addresses.push_back(adr);
+    // 新しい宛先はまだ定義を受信していないため、次の送信ですべての定義を送り直します。
+    if (_dictionary)
+      _dictionary->resync();
   }
 
   void detach(IPAddress ip, uint16_t port) {
@@ -117,132 +220,540 @@ void wlTxDetach(uint8_t port, uint8_t channel) {
     found->second.detach(port);
 }
 
-void wlTxWrite(const Data *buf, size_t size, uint8_t channel) {
+void wlTxSetEncoding(DataEncoding encoding, uint8_t channel) {
+  tx_channels[channel].setEncoding(encoding);
+}
+
+int wlTxDictionaryAdd(const char *str, uint8_t channel) {
+  return tx_channels[channel].dictionary().add(str);
+}
+
+void wlTxDictionaryResync(uint8_t channel) {
   auto found = tx_channels.find(channel);
-  if (found != tx_channels.end())
-    for (size_t i = 0; i < size; ++i)
-      found->second.send(buf[i]);
+  if (found != tx_channels.end() && found->second.hasDictionary())
+    found->second.dictionary().resync();
+}
+
+void wlTxDictionarySetRefresh(uint16_t messages, uint8_t channel) {
+  tx_channels[channel].dictionary().setRefresh(messages);
 }
 
-void wlTxWrite(const Data &data, uint8_t channel) {
+bool wlTxWrite(const Data *buf, size_t size, uint8_t channel) {
   auto found = tx_channels.find(channel);
-  if (found != tx_channels.end())
-    found->second.send(data);
+  if (found == tx_channels.end())
+    return false;
+  // 一部だけ送信することがないように、送信する前にすべてのデータを確認します。
+  for (size_t i = 0; i < size; ++i)
+    if (!found->second.fits(buf[i]))
+      return false;
+  bool sent = true;
+  for (size_t i = 0; i < size; ++i)
+    if (!found->second.send(buf[i]))
+      sent = false;
+  return sent;
+}
+
+bool wlTxWrite(const Data &data, uint8_t channel) {
+  auto found = tx_channels.find(channel);
+  return found != tx_channels.end() && found->second.send(data);
+}
+
+bool wlTxWrite(const Data &data, const uint8_t *channels, size_t count) {
+  // 符号化方式ごとに一度だけシリアライズします（辞書を使用するチャンネルはチャンネルごとにシリアライズします）。
+  TxPacket packets[2];
+  bool sent = true;
+  for (size_t i = 0; i < count; ++i) {
+    // 同じチャンネルが複数回指定された場合は最初の一回だけ送信します。
+    if (std::find(channels, channels + i, channels[i]) != channels + i)
+      continue;
+    auto found = tx_channels.find(channels[i]);
+    if (found == tx_channels.end()) {
+      sent = false;
+      continue;
+    }
+    TxChannel &tx_channel = found->second;
+    TxPacket dict_packet;
+    TxPacket &packet = tx_channel.hasDictionary() ? dict_packet : packets[tx_channel.encoding() == DataEncoding::Compact ? 1 : 0];
+    for (const Address &address : tx_channel.addresses()) {
+      // 先に送信したチャンネルにも接続されているアドレスには送信しません。
+      bool duplicated = false;
+      for (size_t j = 0; j < i && !duplicated; ++j) {
+        auto other = tx_channels.find(channels[j]);
+        duplicated = other != tx_channels.end() && other->second.contains(address);
+      }
+      if (duplicated)
+        continue;
+      if (!packet.serialized() && !packet.serialize(data, tx_channel.encoding(), tx_channel.hasDictionary() ? &tx_channel.dictionary() : nullptr))
+        return false;
+      if (udp.writeTo(packet.bytes(), packet.size(), address.ip, address.port) != packet.size())
+        sent = false;
+    }
+  }
+  return sent;
+}
+
+bool wlTxWrite(const Data &data, std::initializer_list<uint8_t> channels) {
+  return wlTxWrite(data, channels.begin(), channels.size());
+}
+
+bool wlTxWrite(const EncodedData &data, uint8_t channel) {
+  auto found = tx_channels.find(channel);
+  return found != tx_channels.end() && data.size() != 0 && data.size() <= MAX_PACKET_SIZE
+         && found->second.write(data.bytes(), data.size());
+}
+
+bool wlTxWrite(size_t (*sizer)(const void *, DataEncoding), size_t (*serializer)(const void *, uint8_t *, size_t, DataEncoding), const void *value, uint8_t channel) {
+  auto found = tx_channels.find(channel);
+  return found != tx_channels.end() && found->second.send(sizer, serializer, value);
+}
+
+// 受信チャンネル
+struct RxChannel {
+  // どちらか一方だけを構築します。
+  std::unique_ptr<RxQueue> queue;
+  std::unique_ptr<RxMailbox> mailbox;
+  std::atomic<size_t> misses;  // 未定義の辞書のIDのために受信できなかったデータ数
+  // 受信時に呼び出す関数（handledをtrueにした後は変更しません）
+  WlRxCallback callback = nullptr;
+  void *context = nullptr;
+  RxDelivery delivery = RxDelivery::Direct;
+  std::atomic<bool> handled{ false };
+  std::atomic<SemaphoreHandle_t> reader{ nullptr };  // データを待っているタスクを起こすセマフォ
+
+  RxChannel(size_t capacity = WL_RX_QUEUE_SIZE, size_t max_bytes = 0, RxOverflow overflow = RxOverflow::DropNewest, uint32_t timeout_ms = 0)
+    : queue(new RxQueue(capacity, overflow, max_bytes, timeout_ms)), misses(0) {}
+
+  explicit RxChannel(RxMailbox *mailbox)
+    : mailbox(mailbox), misses(0) {}
+
+  // dataは移動して格納し、メールボックスの場合は上書きした古い値と交換します。
+  void push(Data &data, size_t bytes) {
+    if (mailbox)
+      mailbox->store(data);
+    else
+      queue->push(data, bytes);
+  }
+
+  bool pop(Data *const data_p) {
+    return mailbox ? mailbox->take(data_p) : queue->pop(data_p);
+  }
+
+  bool handledBy(RxDelivery by) const noexcept {
+    return handled.load(std::memory_order_acquire) && delivery == by;
+  }
+
+  bool available() {
+    return mailbox ? mailbox->fresh() : queue->size() > 0;
+  }
+
+  // 格納した後に呼び出し、待っているタスクがあれば起こします。
+  void wakeReader() noexcept {
+    // 待つ側の登録と確認の順序に対して、格納と確認の順序を保証します。
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (reader.load(std::memory_order_relaxed) == nullptr)
+      return;
+    SemaphoreHandle_t wake = reader.exchange(nullptr, std::memory_order_acq_rel);
+    if (wake != nullptr)
+      xSemaphoreGive(wake);
+  }
+};
+
+/*
+  受信チャンネルは一度構築すると解放しないため、受信タスクとアプリケーションはロックせずに参照できます。
+  構築と受信ポートの接続、切り離しだけをrx_config_mutexで排他します。
+*/
+static std::atomic<RxChannel *> rx_channels[256];
+static std::mutex rx_config_mutex;
+
+static RxChannel *findRxChannel(uint8_t channel) noexcept {
+  return rx_channels[channel].load(std::memory_order_acquire);
+}
+
+static RxChannel *createRxChannel(uint8_t channel) {
+  RxChannel *rx_channel = findRxChannel(channel);
+  if (rx_channel == nullptr) {
+    rx_channel = new RxChannel();
+    rx_channels[channel].store(rx_channel, std::memory_order_release);
+  }
+  return rx_channel;
+}
+
+/*
+  RxDelivery::Dispatcherの受信チャンネルは、受信タスクがキューに格納した後にビットを立てて配送タスクに通知し、
+  配送タスクがビットの立った受信チャンネルのデータをすべて取り出して関数を呼び出します。
+*/
+static std::atomic<uint32_t> rx_dispatch_pending[256 / 32];
+static std::atomic<TaskHandle_t> rx_dispatch_task(nullptr);
+
+static void rxDispatchTask(void *) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    for (size_t i = 0; i < 256 / 32; ++i)
+      for (uint32_t bits = rx_dispatch_pending[i].exchange(0, std::memory_order_acquire); bits != 0; bits &= bits - 1) {
+        uint8_t channel = i * 32 + __builtin_ctz(bits);
+        RxChannel *rx_channel = findRxChannel(channel);
+        Data data;
+        while (rx_channel->pop(&data))
+          rx_channel->callback(channel, data, rx_channel->context);
+      }
+  }
+}
+
+static void notifyRxDispatcher(uint8_t channel) noexcept {
+  rx_dispatch_pending[channel >> 5].fetch_or(static_cast<uint32_t>(1) << (channel & 31), std::memory_order_release);
+  xTaskNotifyGive(rx_dispatch_task.load(std::memory_order_acquire));
 }
 
 class RxListener {
 private:
+  // 受信タスクから参照する状態
+  struct State {
+    std::atomic<uint32_t> channels[256 / 32];  // 接続されている受信チャンネルのビット列
+    /*
+      デシリアライズ先（受信タスクだけが参照します）
+      メールボックスに格納した場合は上書きされた古い値が戻り、その領域を次の受信で再利用します。
+    */
+    Data received;
+    // 送信元のIPアドレスごとの辞書（受信タスクだけが参照します）
+    struct SourceDictionary {
+      uint32_t ip;
+      uint32_t used;  // 最後に受信したときのusesの値
+      DataDictionary dict;
+    };
+    std::vector<SourceDictionary> dictionaries;
+    uint32_t uses = 0;  // 受信したパケット数
+
+    DataDictionary &dictionary(uint32_t /* ip */);
+  };
+
   std::unique_ptr<AsyncUDP> _listener;
-  std::set<uint8_t> _channels;
+  std::unique_ptr<State> _state;
+  uint16_t _port;
+  bool _listening;
+
+  static void _receive(State &, AsyncUDPPacket &);
 public:
-  RxListener(uint16_t /* port */, uint8_t /* channel */);
+  explicit RxListener(uint16_t /* port */);
 
-  void add_channel(uint8_t channel) {
-    _channels.insert(channel);
-  }
+  void attach(uint8_t /* channel */);
 
-  bool remove_channel(uint8_t channel) {
-    _channels.erase(channel);
-    return _channels.size() != 0;
-  }
+  void detach(uint8_t /* channel */);
 };
 
-static std::unordered_map<uint8_t, std::queue<Data>> rx_bufs;
 static std::unordered_map<uint16_t, RxListener> listeners;
 
-static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
-static volatile bool mux_flag = false;
-static inline void mutEnter() {
-  for (;;) {
-    bool got;
-    portENTER_CRITICAL(&mux);
-    if (!mux_flag) {
-      mux_flag = true;
-      got = true;
-    } else
-      got = false;
-    portEXIT_CRITICAL(&mux);
-    if (got)
-      return;
-    delay(1);
-  }
-}
-static inline void mutExit() {
-  portENTER_CRITICAL(&mux);
-  mux_flag = false;
-  portEXIT_CRITICAL(&mux);
-}
-
-RxListener::RxListener(uint16_t port, uint8_t channel)
-  : _listener(new AsyncUDP()), _channels{ channel } {
-  _listener->listen(port);
-  _listener->onPacket([port](AsyncUDPPacket &packet) {
-    mutEnter();
-    auto found = listeners.find(port);
-    if (found != listeners.end()) {
-      Data data;
-      if (Data::deserialize(packet.data(), packet.length(), &data))
-        for (uint8_t channel : found->second._channels)
-          rx_bufs[channel].push(data);
-    }
-    mutExit();
+RxListener::RxListener(uint16_t port)
+  : _listener(new AsyncUDP()), _state(new State()), _port(port), _listening(false) {
+  for (std::atomic<uint32_t> &bits : _state->channels)
+    bits.store(0, std::memory_order_relaxed);
+  State *state = _state.get();
+  _listener->onPacket([state](AsyncUDPPacket &packet) {
+    _receive(*state, packet);
   });
 }
 
+static_assert(WL_RX_DICTIONARIES > 0, "WL_RX_DICTIONARIES must be positive");
+
+/*
+  送信元の辞書を取得します。
+  辞書の数がWL_RX_DICTIONARIESに達している場合は、最も長く受信していない送信元の辞書を空にして再利用します。
+  削除された辞書のIDを含むデータは受信できなくなり、wlRxDictionaryMissesで取得できる数に加えられます。
+*/
+DataDictionary &RxListener::State::dictionary(uint32_t ip) {
+  ++uses;
+  SourceDictionary *oldest = nullptr;
+  for (SourceDictionary &source : dictionaries) {
+    if (source.ip == ip) {
+      source.used = uses;
+      return source.dict;
+    }
+    if (oldest == nullptr || uses - source.used > uses - oldest->used)
+      oldest = &source;
+  }
+  if (dictionaries.size() < WL_RX_DICTIONARIES) {
+    dictionaries.push_back(SourceDictionary{ ip, uses, DataDictionary() });
+    return dictionaries.back().dict;
+  }
+  oldest->ip = ip;
+  oldest->used = uses;
+  oldest->dict.clear();
+  oldest->dict.misses();
+  return oldest->dict;
+}
+
+void RxListener::_receive(State &state, AsyncUDPPacket &packet) {
+  DataDictionary &dict = state.dictionary(static_cast<uint32_t>(packet.remoteIP()));
+  Data &data = state.received;
+  size_t bytes = packet.length();
+  bool valid = Data::deserialize(packet.data(), bytes, &data, dict);
+  size_t misses = valid ? 0 : dict.misses();
+  if (!valid && misses == 0)
+    return;
+  auto push = [bytes](RxChannel *rx_channel, uint8_t channel, Data &value) {
+    rx_channel->push(value, bytes);
+    if (rx_channel->handledBy(RxDelivery::Dispatcher))
+      notifyRxDispatcher(channel);
+    else
+      rx_channel->wakeReader();
+  };
+  // 最後のチャンネル以外には複製を追加し、最後のチャンネルには移動して追加します。
+  RxChannel *pending = nullptr;
+  uint8_t pending_channel = 0;
+  for (size_t i = 0; i < 256 / 32; ++i)
+    for (uint32_t bits = state.channels[i].load(std::memory_order_acquire); bits != 0; bits &= bits - 1) {
+      uint8_t channel = i * 32 + __builtin_ctz(bits);
+      RxChannel *rx_channel = findRxChannel(channel);
+      if (!valid) {
+        rx_channel->misses.fetch_add(misses, std::memory_order_relaxed);
+        continue;
+      }
+      // 受信タスクで直接呼び出す場合は格納しません。
+      if (rx_channel->handledBy(RxDelivery::Direct)) {
+        rx_channel->callback(channel, data, rx_channel->context);
+        continue;
+      }
+      if (pending != nullptr) {
+        Data copy = data;
+        push(pending, pending_channel, copy);
+      }
+      pending = rx_channel;
+      pending_channel = channel;
+    }
+  if (pending != nullptr)
+    push(pending, pending_channel, data);
+}
+
+void RxListener::attach(uint8_t channel) {
+  _state->channels[channel >> 5].fetch_or(static_cast<uint32_t>(1) << (channel & 31), std::memory_order_release);
+  if (!_listening)
+    _listening = _listener->listen(_port);
+}
+
+void RxListener::detach(uint8_t channel) {
+  _state->channels[channel >> 5].fetch_and(~(static_cast<uint32_t>(1) << (channel & 31)), std::memory_order_release);
+  for (const std::atomic<uint32_t> &bits : _state->channels)
+    if (bits.load(std::memory_order_relaxed) != 0)
+      return;
+  // 受信タスクが参照している可能性があるため、ポートを閉じるだけで解放はしません。
+  _listener->close();
+  _listening = false;
+}
+
+size_t wlRxDictionaryMisses(uint8_t channel) {
+  RxChannel *rx_channel = findRxChannel(channel);
+  return rx_channel != nullptr ? rx_channel->misses.exchange(0, std::memory_order_relaxed) : 0;
+}
+
+size_t wlRxDropped(uint8_t channel) {
+  RxChannel *rx_channel = findRxChannel(channel);
+  if (rx_channel == nullptr)
+    return 0;
+  return rx_channel->mailbox ? rx_channel->mailbox->dropped() : rx_channel->queue->dropped();
+}
+
 size_t wlRxAvailable(uint8_t channel) {
-  size_t available;
-  mutEnter();
-  available = rx_bufs[channel].size();
-  mutExit();
-  return available;
+  RxChannel *rx_channel = findRxChannel(channel);
+  if (rx_channel == nullptr)
+    return 0;
+  return rx_channel->mailbox ? (rx_channel->mailbox->fresh() ? 1 : 0) : rx_channel->queue->size();
+}
+
+// channelsのビットが立っている受信チャンネルのうち、データがある最も小さい番号を返します（ない場合は-1）。
+static int findAvailableRxChannel(const uint32_t (&channels)[256 / 32]) {
+  for (size_t i = 0; i < 256 / 32; ++i)
+    for (uint32_t bits = channels[i]; bits != 0; bits &= bits - 1) {
+      RxChannel *rx_channel = findRxChannel(i * 32 + __builtin_ctz(bits));
+      if (rx_channel != nullptr && rx_channel->available())
+        return i * 32 + __builtin_ctz(bits);
+    }
+  return -1;
+}
+
+/*
+  受信を待つタスクを起こすためのセマフォ
+  アプリケーションのタスク通知と干渉しないように、タスク通知ではなくセマフォで起こします。
+  受信タスクが登録を外した後に与える可能性があるため解放せず、待ち終わったセマフォはここに戻して再利用します。
+  静的変数の破棄の順序に依存しないように、一覧も解放しません。
+*/
+static std::mutex rx_wakers_mutex;
+static std::vector<SemaphoreHandle_t> &rx_wakers = *new std::vector<SemaphoreHandle_t>;
+
+static SemaphoreHandle_t acquireRxWaker() {
+  std::lock_guard<std::mutex> lock(rx_wakers_mutex);
+  if (rx_wakers.empty())
+    return xSemaphoreCreateBinary();
+  SemaphoreHandle_t wake = rx_wakers.back();
+  rx_wakers.pop_back();
+  return wake;
+}
+
+static void releaseRxWaker(SemaphoreHandle_t wake) {
+  std::lock_guard<std::mutex> lock(rx_wakers_mutex);
+  rx_wakers.push_back(wake);
+}
+
+/*
+  channelsの受信チャンネルのいずれかにデータが格納されるまで、startからtimeoutティックまで待ちます。
+  データがある受信チャンネルの番号を返し、タイムアウトした場合は-1を返します。
+  受信タスクに起こしてもらうために、受信チャンネルにセマフォを登録してからもう一度確認します。
+  以前の待機で与えられたセマフォですぐに起きることがありますが、その場合は確認して待ち直します。
+  構築されていない受信チャンネルには登録できないため、待つ前に構築します。
+*/
+static int waitRxChannels(const uint32_t (&channels)[256 / 32], TickType_t start, TickType_t timeout) {
+  for (size_t i = 0; i < 256 / 32; ++i)
+    for (uint32_t bits = channels[i]; bits != 0; bits &= bits - 1)
+      if (findRxChannel(i * 32 + __builtin_ctz(bits)) == nullptr) {
+        std::lock_guard<std::mutex> lock(rx_config_mutex);
+        createRxChannel(i * 32 + __builtin_ctz(bits));
+      }
+  SemaphoreHandle_t wake = nullptr;
+  int found;
+  for (;;) {
+    found = findAvailableRxChannel(channels);
+    if (found >= 0)
+      break;
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    if (timeout != portMAX_DELAY && elapsed >= timeout)
+      break;
+    if (wake == nullptr && (wake = acquireRxWaker()) == nullptr) {
+      // セマフォを作成できない場合は1ティックずつ確認します。
+      vTaskDelay(1);
+      continue;
+    }
+    for (size_t i = 0; i < 256 / 32; ++i)
+      for (uint32_t bits = channels[i]; bits != 0; bits &= bits - 1)
+        findRxChannel(i * 32 + __builtin_ctz(bits))->reader.store(wake, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (findAvailableRxChannel(channels) < 0)
+      xSemaphoreTake(wake, timeout == portMAX_DELAY ? portMAX_DELAY : timeout - elapsed);
+    for (size_t i = 0; i < 256 / 32; ++i)
+      for (uint32_t bits = channels[i]; bits != 0; bits &= bits - 1) {
+        SemaphoreHandle_t expected = wake;
+        findRxChannel(i * 32 + __builtin_ctz(bits))->reader.compare_exchange_strong(expected, nullptr, std::memory_order_relaxed);
+      }
+  }
+  if (wake != nullptr)
+    releaseRxWaker(wake);
+  return found;
+}
+
+static TickType_t rxTimeoutTicks(uint32_t timeout_ms) noexcept {
+  return timeout_ms == portMAX_DELAY ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+}
+
+int wlRxWaitAny(const uint8_t *channels, size_t count, uint32_t timeout_ms) {
+  uint32_t bits[256 / 32] = {};
+  for (size_t i = 0; i < count; ++i)
+    bits[channels[i] >> 5] |= static_cast<uint32_t>(1) << (channels[i] & 31);
+  return waitRxChannels(bits, xTaskGetTickCount(), rxTimeoutTicks(timeout_ms));
+}
+
+int wlRxWaitAny(std::initializer_list<uint8_t> channels, uint32_t timeout_ms) {
+  return wlRxWaitAny(channels.begin(), channels.size(), timeout_ms);
+}
+
+int wlRxWaitAny(uint32_t channel_mask, uint32_t timeout_ms) {
+  uint32_t channels[256 / 32] = { channel_mask };
+  return waitRxChannels(channels, xTaskGetTickCount(), rxTimeoutTicks(timeout_ms));
+}
+
+bool wlRxSetQueue(size_t capacity, size_t max_bytes, RxOverflow overflow, uint32_t timeout_ms, uint8_t channel) {
+  std::lock_guard<std::mutex> lock(rx_config_mutex);
+  // 受信タスクが参照している可能性があるため、構築済みの受信チャンネルは変更できません。
+  if (findRxChannel(channel) != nullptr)
+    return false;
+  rx_channels[channel].store(new RxChannel(capacity, max_bytes, overflow, timeout_ms), std::memory_order_release);
+  return true;
+}
+
+bool wlRxSetMailbox(uint8_t channel) {
+  std::lock_guard<std::mutex> lock(rx_config_mutex);
+  if (findRxChannel(channel) != nullptr)
+    return false;
+  rx_channels[channel].store(new RxChannel(new RxMailbox()), std::memory_order_release);
+  return true;
 }
 
 void wlRxAttach(uint16_t port, uint8_t channel) {
-  mutEnter();
+  std::lock_guard<std::mutex> lock(rx_config_mutex);
+  // 受信タスクが参照する前に受信チャンネルを構築します。
+  createRxChannel(channel);
   auto found = listeners.find(port);
-  if (found != listeners.end())
-    found->second.add_channel(channel);
-  else
-    listeners.emplace(port, RxListener(port, channel));
-  mutExit();
+  if (found == listeners.end())
+    found = listeners.emplace(port, RxListener(port)).first;
+  found->second.attach(channel);
 }
 
+bool wlRxOnData(uint8_t channel, WlRxCallback callback, void *context, RxDelivery delivery) {
+  if (callback == nullptr)
+    return false;
+  std::lock_guard<std::mutex> lock(rx_config_mutex);
+  if (delivery == RxDelivery::Dispatcher && rx_dispatch_task.load(std::memory_order_relaxed) == nullptr) {
+    TaskHandle_t handle = nullptr;
+    if (xTaskCreatePinnedToCore(rxDispatchTask, "rxDispatchTask", WL_RX_DISPATCH_TASK_STACK_SIZE, nullptr, WL_RX_DISPATCH_TASK_PRIORITY, &handle, WL_RX_DISPATCH_TASK_CORE) != pdPASS)
+      return false;
+    rx_dispatch_task.store(handle, std::memory_order_release);
+  }
+  RxChannel *rx_channel = createRxChannel(channel);
+  if (rx_channel->handled.load(std::memory_order_relaxed))
+    return false;
+  rx_channel->callback = callback;
+  rx_channel->context = context;
+  rx_channel->delivery = delivery;
+  rx_channel->handled.store(true, std::memory_order_release);
+  // 設定する前に格納されたデータも配送します。
+  if (delivery == RxDelivery::Dispatcher)
+    notifyRxDispatcher(channel);
+  return true;
+}
 
-void wlRxDettach(uint16_t port, uint8_t channel) {
-  mutEnter();
+void wlRxDetach(uint16_t port, uint8_t channel) {
+  std::lock_guard<std::mutex> lock(rx_config_mutex);
   auto found = listeners.find(port);
   if (found != listeners.end())
-    if (!found->second.remove_channel(channel))
-      listeners.erase(port);
-  mutExit();
+    found->second.detach(channel);
 }
 
 Data wlRxRead(uint8_t channel) {
-  mutEnter();
-  std::queue<Data> &rx_buf = rx_bufs[channel];
+  RxChannel *rx_channel = findRxChannel(channel);
   Data data;
-  if (rx_buf.empty())
+  if (rx_channel == nullptr || !rx_channel->pop(&data))
     data = nullptr;
-  else {
-    data = rx_buf.front();
-    rx_buf.pop();
+  return data;
+}
+
+Data wlRxReadWait(uint8_t channel, uint32_t timeout_ms) {
+  TickType_t start = xTaskGetTickCount();
+  TickType_t timeout = rxTimeoutTicks(timeout_ms);
+  uint32_t channels[256 / 32] = {};
+  channels[channel >> 5] = static_cast<uint32_t>(1) << (channel & 31);
+  Data data;
+  // 待っている間に他のタスクに取り出された場合は、残りの時間でもう一度待ちます。
+  for (;;) {
+    RxChannel *rx_channel = findRxChannel(channel);
+    if (rx_channel != nullptr && rx_channel->pop(&data))
+      return data;
+    if (waitRxChannels(channels, start, timeout) < 0)
+      return nullptr;
   }
+}
 
-  mutExit();
+Data wlRxRead(uint8_t channel, uint32_t *version_p) {
+  RxChannel *rx_channel = findRxChannel(channel);
+  Data data;
+  *version_p = 0;
+  if (rx_channel != nullptr && rx_channel->mailbox)
+    *version_p = rx_channel->mailbox->latest(&data);
+  else if (rx_channel == nullptr || !rx_channel->pop(&data))
+    data = nullptr;
   return data;
 }
 
 size_t wlRxRead(Data *buffer, size_t size, uint8_t channel) {
-  mutEnter();
+  RxChannel *rx_channel = findRxChannel(channel);
   size_t read_bytes = 0;
-  auto found = rx_bufs.find(channel);
-  if (found != rx_bufs.end()) {
-    std::queue<Data> &rx_buf = found->second;
-    while (read_bytes < size && !rx_buf.empty()) {
-      buffer[read_bytes++] = rx_buf.front();
-      rx_buf.pop();
-    }
-  }
-  mutExit();
+  if (rx_channel != nullptr)
+    while (read_bytes < size && rx_channel->pop(&buffer[read_bytes]))
+      ++read_bytes;
   return read_bytes;
-}
\ No newline at end of file
+}
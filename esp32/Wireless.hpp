@@ -5,6 +5,7 @@
 #include <AsyncUDP.h>
 #include <WiFi.h>
 
+#include <initializer_list>
 #include <memory>
 #include <queue>
 #include <set>
@@ -12,6 +13,48 @@
 #include <vector>
 
 #include "Data.hpp"
+#include "DataDictionary.hpp"
+#include "DataRing.hpp"
+#include "DataStruct.hpp"
+#include "EncodedData.hpp"
+#include "RxMailbox.hpp"
+#include "RxQueue.hpp"
+
+#ifndef WL_RX_QUEUE_SIZE
+// 受信チャンネルごとに格納できるデータ数の既定値
+#define WL_RX_QUEUE_SIZE 32
+#endif
+
+#ifndef WL_RX_DICTIONARIES
+// 受信ポートごとに辞書を保持する送信元のIPアドレスの数（超える場合は最も長く受信していない送信元の辞書を削除します）
+#define WL_RX_DICTIONARIES 8
+#endif
+
+#ifndef WL_RX_DISPATCH_TASK_CORE
+// 受信したデータを関数に配送するタスクを実行するコア
+#define WL_RX_DISPATCH_TASK_CORE 1
+#endif
+
+#ifndef WL_RX_DISPATCH_TASK_PRIORITY
+// 受信したデータを関数に配送するタスクの優先度
+#define WL_RX_DISPATCH_TASK_PRIORITY 5
+#endif
+
+#ifndef WL_RX_DISPATCH_TASK_STACK_SIZE
+// 受信したデータを関数に配送するタスクのスタックメモリサイズ
+#define WL_RX_DISPATCH_TASK_STACK_SIZE 4096
+#endif
+
+/*
+  受信したデータを関数に渡す方法を表す列挙型
+*/
+enum class RxDelivery : uint8_t {
+  Direct,     // 受信タスクで直接呼び出します（受信チャンネルには格納しません）
+  Dispatcher  // 受信チャンネルに格納し、配送タスクで呼び出します
+};
+
+// 受信したデータを渡す関数（受信チャンネル、データ、wlRxOnDataで指定したcontext）
+using WlRxCallback = void (*)(uint8_t /* channel */, const Data& /* data */, void* /* context */);
 
 /*
   無線LANに接続します。
@@ -44,31 +87,157 @@ void wlTxDetach(IPAddress /* ip */, uint8_t /* channel */ = 0);
   ポート番号が一致するすべてのポートを送信チャンネルから切り離します。
 */
 void wlTxDetach(uint16_t /* port */, uint8_t /* channel */ = 0);
+/*
+  送信チャンネルで送信するデータの整数の表現を設定します。
+  DataEncoding::Compactを設定すると、小さな整数値を少ないバイト数で送信します。
+*/
+void wlTxSetEncoding(DataEncoding /* encoding */, uint8_t /* channel */ = 0);
+/*
+  送信チャンネルの辞書に文字列を登録し、割り当てたIDを返します。
+  登録した文字列は最初の一回だけ定義を送信し、以降はIDだけを送信します。
+  登録できる数を超える場合は-1を返します。
+  同じ宛先に複数のチャンネルから辞書を使用して送信しないでください。
+  辞書を使用する送信チャンネルに新しい宛先を接続すると、次の送信ですべての定義を送り直します。
+*/
+int wlTxDictionaryAdd(const char* /* str */, uint8_t /* channel */ = 0);
+/*
+  送信チャンネルの辞書のすべての定義を、次に使用するときに送り直します。
+  受信側のwlRxDictionaryMissesが0でなくなった場合に呼び出します。
+*/
+void wlTxDictionaryResync(uint8_t /* channel */ = 0);
+/*
+  送信チャンネルの辞書の定義を、指定したメッセージ数ごとに送り直します。
+  0を指定すると自動では送り直しません。
+*/
+void wlTxDictionarySetRefresh(uint16_t /* messages */, uint8_t /* channel */ = 0);
 /*
   送信チャンネルにすべてのデータを送信します。
+  送信する前にすべてのデータの大きさを確認し、シリアライズできないデータやUDPで送信できる大きさを超えるデータがある場合は、何も送信せずにfalseを返します。
+  チャンネルがない場合や、送信の途中でUDPの書き込みに失敗した場合もfalseを返します（それまでのデータは送信されています）。
 */
-void wlTxWrite(const Data* /* buffer */, size_t /* size */, uint8_t /* channel */ = 0);
+bool wlTxWrite(const Data* /* buffer */, size_t /* size */, uint8_t /* channel */ = 0);
 /*
   送信チャンネルにデータを送信します。
+  データはシリアライズ後のバイト数に合わせたバッファで送信されます。
+  チャンネルがない場合やデータがUDPで送信できる大きさを超える場合はfalseを返します。
+*/
+bool wlTxWrite(const Data& /* data */, uint8_t /* channel */ = 0);
+/*
+  複数の送信チャンネルにデータを送信します。
+  データはチャンネルの符号化方式ごとに一度だけシリアライズされ、
+  複数のチャンネルに接続されているIPアドレスとポート番号には一度だけ送信されます。
+  存在しないチャンネルがある場合や送信できなかった場合はfalseを返します。
+*/
+bool wlTxWrite(const Data& /* data */, const uint8_t* /* channels */, size_t /* count */);
+/*
+  複数の送信チャンネルにデータを送信します。
+*/
+bool wlTxWrite(const Data& /* data */, std::initializer_list<uint8_t> /* channels */);
+/*
+  シリアライズ関数でバッファに書き込んだバイト列を送信チャンネルに送信します。
+  サイズ関数が返したバイト数のバッファを一度だけ確保し、シリアライズ関数はそのバイト数を書き込む必要があります。
+  サイズ関数が0を返した場合は送信せずにfalseを返します。
+*/
+bool wlTxWrite(size_t (*/* sizer */)(const void*, DataEncoding), size_t (*/* serializer */)(const void*, uint8_t*, size_t, DataEncoding), const void* /* value */, uint8_t /* channel */ = 0);
+/*
+  シリアライズ済みのデータを送信チャンネルに送信します。
+  バイト列はチャンネルの符号化方式に関わらずそのまま送信されます。
+*/
+bool wlTxWrite(const EncodedData& /* data */, uint8_t /* channel */ = 0);
+/*
+  WL_STRUCTで登録した構造体の値を、Dataを構築せずに送信チャンネルに送信します。
+*/
+template<class T, class = decltype(DataStruct<T>::members())>
+bool wlTxWrite(const T& value, uint8_t channel = 0) {
+  return wlTxWrite([](const void* v, DataEncoding encoding) {
+    return serializedSizeStruct(*static_cast<const T*>(v), encoding);
+  }, [](const void* v, uint8_t* buf, size_t size, DataEncoding encoding) {
+    return serializeStruct(*static_cast<const T*>(v), buf, size, encoding);
+  }, &value, channel);
+}
+/*
+  定義を受信していない辞書のIDを含むため受信できなかったデータ数を取得し、0に戻します。
+  0でない場合は、送信側でwlTxDictionaryResyncを呼び出すように要求してください。
+*/
+size_t wlRxDictionaryMisses(uint8_t /* channel */ = 0);
+/*
+  受信キューが満杯のために破棄したデータ数を取得し、0に戻します。
+  メールボックスの場合は、取り出される前に上書きされた値の数を取得します。
 */
-void wlTxWrite(const Data& /* data */, uint8_t /* channel */ = 0);
+size_t wlRxDropped(uint8_t /* channel */ = 0);
 /*
   受信チャンネルから取り出すことができるデータ数を取得します。
+  メールボックスの場合は、まだ取り出していない値があれば1を返します。
 */
 size_t wlRxAvailable(uint8_t /* channel */ = 0);
+/*
+  受信チャンネルのキューの上限と、満杯のときの動作を設定します。
+  capacityはデータ数、max_bytesは受信したバイト数の合計の上限です（0の場合は制限しません）。
+  RxOverflow::Blockの場合は、最大timeout_msミリ秒まで受信タスクを待たせます。待っている間は同じポートの他のチャンネルも受信できません。
+  最初のwlRxAttachやwlRxOnDataより前に呼び出してください。受信チャンネルが構築済みの場合はfalseを返します。
+*/
+bool wlRxSetQueue(size_t /* capacity */, size_t /* max_bytes */ = 0, RxOverflow /* overflow */ = RxOverflow::DropNewest, uint32_t /* timeout_ms */ = 0, uint8_t /* channel */ = 0);
+/*
+  受信チャンネルを、最新の値だけを保持するメールボックスにします。
+  受信した値は古い値を上書きするため、処理が遅れても古い値が溜まりません。
+  上書きは古い値の領域を再利用するため、古い値を参照しているデータがなければメモリを確保しません。
+  最初のwlRxAttachやwlRxOnDataより前に呼び出してください。受信チャンネルが構築済みの場合はfalseを返します。
+*/
+bool wlRxSetMailbox(uint8_t /* channel */ = 0);
 /*
   ポートを受信チャンネルに接続します。
+  wlRxSetQueueを呼び出していない場合、受信チャンネルにはWL_RX_QUEUE_SIZE個までデータを格納でき、満杯の場合は受信したデータを破棄します。
 */
 void wlRxAttach(uint16_t /* port */, uint8_t /* channel */ = 0);
+/*
+  受信チャンネルがデータを受信したときに呼び出す関数を設定します。
+  RxDelivery::Directの場合は受信タスクで直接呼び出すため、最も早く反応できますが、関数が戻るまで次の受信は待たされます。
+  RxDelivery::Dispatcherの場合はWL_RX_DISPATCH_TASK_COREのコアで動作する配送タスクで呼び出し、
+  受信チャンネルのキューの上限と満杯のときの動作はwlRxSetQueueの設定に従います。
+  関数を設定した受信チャンネルはwlRxReadで読み出さないでください。
+  受信チャンネルごとに一度だけ設定でき、設定済みの場合や配送タスクを起動できない場合はfalseを返します。
+*/
+bool wlRxOnData(uint8_t /* channel */, WlRxCallback /* callback */, void* /* context */ = nullptr, RxDelivery /* delivery */ = RxDelivery::Direct);
 /*
   ポートを受信チャンネルから切り離します。
 */
 void wlRxDetach(uint16_t /* port */, uint8_t /* channel */ = 0);
 /*
   チャンネルからデータを取り出します。
-  データがない場合はブロックされます。
+  データがない場合は待たずにNullを返します。
+  メールボックスの場合は、まだ取り出していない最新の値を返します。
 */
 Data wlRxRead(uint8_t /* channel */ = 0);
+/*
+  チャンネルからデータを取り出します。
+  データがない場合は、受信するまで最大timeout_msミリ秒タスクを休止させて待ち、タイムアウトした場合はNullを返します。
+  timeout_msにportMAX_DELAYを指定すると無期限に待ちます。
+  一つの受信チャンネルを待つことができるのは一つのタスクだけです。
+  まだ構築されていない受信チャンネルは既定の設定で構築します。
+*/
+Data wlRxReadWait(uint8_t /* channel */, uint32_t /* timeout_ms */);
+/*
+  指定した受信チャンネルのいずれかにデータがあるまで、最大timeout_msミリ秒タスクを休止させて待ちます。
+  データがある最も小さい受信チャンネルの番号を返し、タイムアウトした場合は-1を返します。データは取り出しません。
+  timeout_msにportMAX_DELAYを指定すると無期限に待ちます。
+  まだ構築されていない受信チャンネルは既定の設定で構築するため、wlRxSetQueueやwlRxSetMailboxは待つ前に呼び出してください。
+*/
+int wlRxWaitAny(const uint8_t* /* channels */, size_t /* count */, uint32_t /* timeout_ms */);
+/*
+  指定した受信チャンネルのいずれかにデータがあるまで待ちます。
+*/
+int wlRxWaitAny(std::initializer_list<uint8_t> /* channels */, uint32_t /* timeout_ms */);
+/*
+  channel_maskのビットが立っている受信チャンネル（0番から31番）のいずれかにデータがあるまで待ちます。
+  32番以降の受信チャンネルを待つ場合は、チャンネルの配列を指定してください。
+*/
+int wlRxWaitAny(uint32_t /* channel_mask */, uint32_t /* timeout_ms */);
+/*
+  メールボックスから、取り出し済みかどうかに関わらず最新の値を取り出し、version_pにそのバージョンを格納します。
+  バージョンは受信した回数で、前回と異なれば新しい値です（未受信の場合は0でNullを返します）。
+  メールボックスでない場合はwlRxRead(channel)と同じで、バージョンは0になります。
+*/
+Data wlRxRead(uint8_t /* channel */, uint32_t* /* version_p */);
 /*
   チャンネルからデータを取り出してバッファに格納します。
   取り出したデータ数を返します。
@@ -1,4 +1,11 @@
 #include "Data.hpp"
+#include "DataDictionary.hpp"
+#include "DataRing.hpp"
+#include "DataStruct.hpp"
+#include "DataView.hpp"
+#include "EncodedData.hpp"
+#include "RxMailbox.hpp"
+#include "RxQueue.hpp"
 #include "SerialUtil.hpp"
 #include "Wireless.hpp"
 
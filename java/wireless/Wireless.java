@@ -12,6 +12,7 @@ import java.util.ArrayDeque;
 import java.util.Arrays;
 import java.util.HashMap;
 import java.util.HashSet;
+import java.util.LinkedHashMap;
 import java.util.Map;
 import java.util.Queue;
 import java.util.Set;
@@ -20,15 +21,20 @@ import java.util.concurrent.Executors;
 import java.util.concurrent.atomic.AtomicBoolean;
 
 import wireless.data.Data;
+import wireless.data.StringDictionary;
 
 public class Wireless implements AutoCloseable {
     /** 送受信可能な最大バイト数 */
-    public static final int MAX_PACKET_SIZE = 1024;
+    public static final int MAX_PACKET_SIZE = 65507;
+    /** 受信ポートごとに定義を記録する送信元の最大数（ESP32のWL_RX_DICTIONARIESの既定値と同じです） */
+    public static final int RX_DICTIONARIES = 8;
 
     /** 受信バッファマップ（key: チャンネル, value: 受信バッファ） */
     private final Map<Integer, Queue<Data>> rxBuffers = new HashMap<>();
     /** 受信チャンネルマップ（key: ポート番号, value: チャンネルの集合） */
     private final Map<Integer, Set<Integer>> rxChannels = new HashMap<>();
+    /** 辞書の未定義のIDのために受信できなかったデータ数（key: チャンネル, value: データ数） */
+    private final Map<Integer, Integer> rxMisses = new HashMap<>();
     /** 送信チャンネルマップ（key: チャンネル, value: アドレスの集合） */
     private final Map<Integer, Set<InetSocketAddress>> txAddresses = new HashMap<>();
     /** スレッドプール */
@@ -45,15 +51,26 @@ public class Wireless implements AutoCloseable {
     private void receive(int port) {
         try (DatagramSocket socket = new DatagramSocket(port)) {
             socket.setSoTimeout(1000);
+            byte[] buf = new byte[MAX_PACKET_SIZE];
+            // 送信元のIPアドレスごとの辞書（最も長く受信していない送信元の辞書から削除します）
+            Map<InetAddress, StringDictionary> dictionaries = new LinkedHashMap<>(16, 0.75f, true) {
+                @Override
+                protected boolean removeEldestEntry(Map.Entry<InetAddress, StringDictionary> eldest) {
+                    return size() > RX_DICTIONARIES;
+                }
+            };
             while (running.get())
                 try {
-                    byte[] buf = new byte[MAX_PACKET_SIZE];
                     DatagramPacket packet = new DatagramPacket(buf, buf.length);
                     socket.receive(packet);
-                    Data data = Data.deserialize(ByteBuffer.wrap(Arrays.copyOf(packet.getData(), packet.getLength())));
+                    StringDictionary dictionary = dictionaries.computeIfAbsent(packet.getAddress(), address -> new StringDictionary());
+                    Data data = Data.deserialize(ByteBuffer.wrap(Arrays.copyOf(packet.getData(), packet.getLength())), dictionary);
+                    int misses = dictionary.takeMisses();
                     synchronized (this) {
                         if (rxChannels.containsKey(port))
-                            for (int channel : rxChannels.get(port))
+                            for (int channel : rxChannels.get(port)) {
+                                if (misses != 0)
+                                    rxMisses.merge(channel, misses, Integer::sum);
                                 if (rxBuffers.containsKey(channel))
                                     rxBuffers.get(channel).add(data);
                                 else {
@@ -61,6 +78,7 @@ public class Wireless implements AutoCloseable {
                                     rxBuf.add(data);
                                     rxBuffers.put(channel, rxBuf);
                                 }
+                            }
                     }
                 } catch (SocketTimeoutException e) {
                     // DO NOTHING
@@ -135,6 +153,27 @@ public class Wireless implements AutoCloseable {
         return available(0);
     }
 
+    /**
+     * 定義を受信していない辞書のIDを含むため受信できなかったデータ数を取得し、0に戻します。
+     * 0でない場合は、送信側でwlTxDictionaryResyncを呼び出すように要求してください。
+     * 
+     * @param channel 受信チャンネル
+     * @return 受信できなかったデータ数
+     */
+    public synchronized int dictionaryMisses(int channel) {
+        Integer misses = rxMisses.remove(channel);
+        return misses != null ? misses : 0;
+    }
+
+    /**
+     * 受信チャンネル0で、定義を受信していない辞書のIDを含むため受信できなかったデータ数を取得し、0に戻します。
+     * 
+     * @return 受信できなかったデータ数
+     */
+    public int dictionaryMisses() {
+        return dictionaryMisses(0);
+    }
+
     /**
      * 受信チャンネルからデータを取り出します。
      * 
@@ -162,9 +201,21 @@ public class Wireless implements AutoCloseable {
      * @throws IOException 通信エラー
      */
     public void write(Data data, int channel) throws IOException {
+        write(data, channel, false);
+    }
+
+    /**
+     * データを送信チャンネルに送信します。
+     * 
+     * @param data    データ
+     * @param channel 送信チャンネル
+     * @param compact 16bit以上の整数を可変長整数で送信する場合はtrue
+     * @throws IOException 通信エラー
+     */
+    public void write(Data data, int channel, boolean compact) throws IOException {
         if (txAddresses.containsKey(channel)) {
             ByteBuffer buffer = ByteBuffer.allocate(MAX_PACKET_SIZE);
-            data.serialize(buffer);
+            data.serialize(buffer, compact);
             buffer.flip();
             byte[] buf = new byte[buffer.limit()];
             buffer.get(buf);
@@ -1,5 +1,6 @@
 package wireless.data;
 
+import java.nio.BufferUnderflowException;
 import java.nio.ByteBuffer;
 import java.nio.ByteOrder;
 
@@ -17,6 +18,26 @@ public class Data implements Cloneable {
     public static final byte TYPE_UINT16 = 10;
     public static final byte TYPE_UINT32 = 11;
     public static final byte TYPE_UINTt64 = 12;
+    public static final byte TYPE_INT8_ARRAY = 13;
+    public static final byte TYPE_INT16_ARRAY = 14;
+    public static final byte TYPE_INT32_ARRAY = 15;
+    public static final byte TYPE_INT64_ARRAY = 16;
+    public static final byte TYPE_UINT8_ARRAY = 17;
+    public static final byte TYPE_UINT16_ARRAY = 18;
+    public static final byte TYPE_UINT32_ARRAY = 19;
+    public static final byte TYPE_UINT64_ARRAY = 20;
+    public static final byte TYPE_FLOAT32 = 21;
+    public static final byte TYPE_FLOAT64 = 22;
+    public static final byte TYPE_VAR_INT16 = 23;
+    public static final byte TYPE_VAR_INT32 = 24;
+    public static final byte TYPE_VAR_INT64 = 25;
+    public static final byte TYPE_VAR_UINT16 = 26;
+    public static final byte TYPE_VAR_UINT32 = 27;
+    public static final byte TYPE_VAR_UINT64 = 28;
+    public static final byte TYPE_BOOL_ARRAY = 29;
+    public static final byte TYPE_TIME_SERIES = 30;
+    public static final byte TYPE_STRING_DEF = 31;
+    public static final byte TYPE_STRING_REF = 32;
 
     private final DataType type;
     private final Object data;
@@ -96,6 +117,24 @@ public class Data implements Cloneable {
         this(DataType.Int64, i64);
     }
 
+    /**
+     * Float32型の値をもつデータを構築します。
+     * 
+     * @param f32 Float32型の値
+     */
+    public Data(float f32) {
+        this(DataType.Float32, f32);
+    }
+
+    /**
+     * Float64型の値をもつデータを構築します。
+     * 
+     * @param f64 Float64型の値
+     */
+    public Data(double f64) {
+        this(DataType.Float64, f64);
+    }
+
     /**
      * Int8型の値をもつデータを構築します。
      * 
@@ -176,7 +215,159 @@ public class Data implements Cloneable {
         return new Data(DataType.UInt64, i);
     }
 
-    private void _serialize(ByteBuffer buffer) {
+    /**
+     * Bool型の配列の値をもつデータを構築します。
+     * 
+     * @param bs Bool型の配列
+     */
+    public Data(boolean[] bs) {
+        this(DataType.BoolArray, bs.clone());
+    }
+
+    /**
+     * Int8型の数値配列の値をもつデータを構築します。
+     * 
+     * @param i8s Int8型の数値配列
+     */
+    public Data(byte[] i8s) {
+        this(DataType.Int8Array, i8s.clone());
+    }
+
+    /**
+     * Int16型の数値配列の値をもつデータを構築します。
+     * 
+     * @param i16s Int16型の数値配列
+     */
+    public Data(short[] i16s) {
+        this(DataType.Int16Array, i16s.clone());
+    }
+
+    /**
+     * Int32型の数値配列の値をもつデータを構築します。
+     * 
+     * @param i32s Int32型の数値配列
+     */
+    public Data(int[] i32s) {
+        this(DataType.Int32Array, i32s.clone());
+    }
+
+    /**
+     * Int64型の数値配列の値をもつデータを構築します。
+     * 
+     * @param i64s Int64型の数値配列
+     */
+    public Data(long[] i64s) {
+        this(DataType.Int64Array, i64s.clone());
+    }
+
+    /**
+     * UInt8型の数値配列の値をもつデータを構築します。
+     * 
+     * @param i UInt8型の数値配列
+     * @return 構築されたデータ
+     */
+    public static Data asUInt8Array(byte[] i) {
+        return new Data(DataType.UInt8Array, i.clone());
+    }
+
+    /**
+     * UInt16型の数値配列の値をもつデータを構築します。
+     * 
+     * @param i UInt16型の数値配列
+     * @return 構築されたデータ
+     */
+    public static Data asUInt16Array(short[] i) {
+        return new Data(DataType.UInt16Array, i.clone());
+    }
+
+    /**
+     * UInt32型の数値配列の値をもつデータを構築します。
+     * 
+     * @param i UInt32型の数値配列
+     * @return 構築されたデータ
+     */
+    public static Data asUInt32Array(int[] i) {
+        return new Data(DataType.UInt32Array, i.clone());
+    }
+
+    /**
+     * UInt64型の数値配列の値をもつデータを構築します。
+     * 
+     * @param i UInt64型の数値配列
+     * @return 構築されたデータ
+     */
+    public static Data asUInt64Array(long[] i) {
+        return new Data(DataType.UInt64Array, i.clone());
+    }
+
+    // 可変長整数（LEB128）で書き込みます。
+    private static void putVarLong(ByteBuffer buffer, long v) {
+        while ((v & ~0x7FL) != 0) {
+            buffer.put((byte) (v & 0x7F | 0x80));
+            v >>>= 7;
+        }
+        buffer.put((byte) v);
+    }
+
+    // 可変長整数（LEB128）をbitsビットの値として読み出します。値が収まらない場合はnullを返します。
+    private static Long getVarLong(ByteBuffer buffer, int bits) {
+        long v = 0;
+        for (int shift = 0; shift < bits; shift += 7) {
+            byte b = buffer.get();
+            v |= (long) (b & 0x7F) << shift;
+            if ((b & 0x80) == 0) {
+                if (bits < 64 ? (v >>> bits) != 0 : shift == 63 && (b & 0x7F) > 1)
+                    return null;
+                return v;
+            }
+        }
+        return null;
+    }
+
+    private static long zigzag(long v) {
+        return (v << 1) ^ (v >> 63);
+    }
+
+    private static long unzigzag(long v) {
+        return (v >>> 1) ^ -(v & 1);
+    }
+
+    private void _serialize(ByteBuffer buffer, boolean compact) {
+        if (compact)
+            switch (type) {
+                case Int16 -> {
+                    buffer.put(TYPE_VAR_INT16);
+                    putVarLong(buffer, zigzag((Short) data) & 0xFFFFL);
+                    return;
+                }
+                case Int32 -> {
+                    buffer.put(TYPE_VAR_INT32);
+                    putVarLong(buffer, zigzag((Integer) data) & 0xFFFFFFFFL);
+                    return;
+                }
+                case Int64 -> {
+                    buffer.put(TYPE_VAR_INT64);
+                    putVarLong(buffer, zigzag((Long) data));
+                    return;
+                }
+                case UInt16 -> {
+                    buffer.put(TYPE_VAR_UINT16);
+                    putVarLong(buffer, Short.toUnsignedLong((Short) data));
+                    return;
+                }
+                case UInt32 -> {
+                    buffer.put(TYPE_VAR_UINT32);
+                    putVarLong(buffer, Integer.toUnsignedLong((Integer) data));
+                    return;
+                }
+                case UInt64 -> {
+                    buffer.put(TYPE_VAR_UINT64);
+                    putVarLong(buffer, (Long) data);
+                    return;
+                }
+                default -> {
+                }
+            }
         switch (type) {
             case Null -> buffer.put(TYPE_NULL);
             case Bool -> buffer.put((Boolean) data ? TYPE_TRUE : TYPE_FALSE);
@@ -191,7 +382,7 @@ public class Data implements Cloneable {
                 buffer.put(TYPE_ARRAY);
                 buffer.putShort((short) array.length);
                 for (Data a : array)
-                    a._serialize(buffer);
+                    a._serialize(buffer, compact);
             }
             case Int8 -> {
                 buffer.put(TYPE_INT8);
@@ -225,17 +416,74 @@ public class Data implements Cloneable {
                 buffer.put(TYPE_UINTt64);
                 buffer.putLong((Long) data);
             }
+            case Float32 -> {
+                buffer.put(TYPE_FLOAT32);
+                buffer.putFloat((Float) data);
+            }
+            case Float64 -> {
+                buffer.put(TYPE_FLOAT64);
+                buffer.putDouble((Double) data);
+            }
+            case Int8Array, UInt8Array -> {
+                byte[] array = (byte[]) data;
+                buffer.put(type == DataType.Int8Array ? TYPE_INT8_ARRAY : TYPE_UINT8_ARRAY);
+                buffer.putShort((short) array.length);
+                buffer.put(array);
+            }
+            case Int16Array, UInt16Array -> {
+                short[] array = (short[]) data;
+                buffer.put(type == DataType.Int16Array ? TYPE_INT16_ARRAY : TYPE_UINT16_ARRAY);
+                buffer.putShort((short) array.length);
+                for (short a : array)
+                    buffer.putShort(a);
+            }
+            case Int32Array, UInt32Array -> {
+                int[] array = (int[]) data;
+                buffer.put(type == DataType.Int32Array ? TYPE_INT32_ARRAY : TYPE_UINT32_ARRAY);
+                buffer.putShort((short) array.length);
+                for (int a : array)
+                    buffer.putInt(a);
+            }
+            case Int64Array, UInt64Array -> {
+                long[] array = (long[]) data;
+                buffer.put(type == DataType.Int64Array ? TYPE_INT64_ARRAY : TYPE_UINT64_ARRAY);
+                buffer.putShort((short) array.length);
+                for (long a : array)
+                    buffer.putLong(a);
+            }
+            case BoolArray -> {
+                // 1バイトに8個ずつ下位ビットから詰めて書き込みます。
+                boolean[] array = (boolean[]) data;
+                byte[] packed = new byte[(array.length + 7) / 8];
+                for (int i = 0; i < array.length; ++i)
+                    if (array[i])
+                        packed[i >> 3] |= (byte) (1 << (i & 7));
+                buffer.put(TYPE_BOOL_ARRAY);
+                buffer.putShort((short) array.length);
+                buffer.put(packed);
+            }
+            case TimeSeries -> {
+                // 値の型、組の数、バイト数と圧縮されたビット列をそのまま書き込みます。
+                buffer.put(TYPE_TIME_SERIES);
+                buffer.put((byte[]) data);
+            }
         }
     }
 
     public void serialize(ByteBuffer buffer) {
+        serialize(buffer, false);
+    }
+
+    // compactがtrueの場合は16bit以上の整数を可変長整数（符号付きはZigZag符号化）で書き込みます。
+    public void serialize(ByteBuffer buffer, boolean compact) {
         buffer.order(ByteOrder.LITTLE_ENDIAN);
-        _serialize(buffer);
+        _serialize(buffer, compact);
     }
 
-    private static Data _deserialize(ByteBuffer buffer) {
+    private static Data _deserialize(ByteBuffer buffer, StringDictionary dictionary) {
         Data data;
-        switch (buffer.get()) {
+        byte tag = buffer.get();
+        switch (tag) {
             case TYPE_NULL -> data = new Data();
             case TYPE_TRUE -> data = new Data(true);
             case TYPE_FALSE -> data = new Data(false);
@@ -245,11 +493,31 @@ public class Data implements Cloneable {
                 buffer.get(buf);
                 data = new Data(new String(buf));
             }
+            case TYPE_STRING_DEF -> {
+                if (dictionary == null)
+                    return null;
+                int id = Byte.toUnsignedInt(buffer.get());
+                byte[] buf = new byte[Short.toUnsignedInt(buffer.getShort())];
+                buffer.get(buf);
+                String str = new String(buf);
+                dictionary.define(id, str);
+                data = new Data(str);
+            }
+            case TYPE_STRING_REF -> {
+                if (dictionary == null)
+                    return null;
+                String str = dictionary.lookup(Byte.toUnsignedInt(buffer.get()));
+                if (str == null) {
+                    dictionary.miss();
+                    return null;
+                }
+                data = new Data(str);
+            }
             case TYPE_ARRAY -> {
                 int length = Short.toUnsignedInt(buffer.getShort());
                 Data[] array = new Data[length];
                 for (int i = 0; i < length; ++i)
-                    if ((array[i] = _deserialize(buffer)) == null)
+                    if ((array[i] = _deserialize(buffer, dictionary)) == null)
                         return null;
                 data = new Data(array);
             }
@@ -261,14 +529,85 @@ public class Data implements Cloneable {
             case TYPE_UINT16 -> data = asUInt16(buffer.getShort());
             case TYPE_UINT32 -> data = asUInt32(buffer.getInt());
             case TYPE_UINTt64 -> data = asUInt64(buffer.getLong());
+            case TYPE_FLOAT32 -> data = new Data(buffer.getFloat());
+            case TYPE_FLOAT64 -> data = new Data(buffer.getDouble());
+            case TYPE_INT8_ARRAY, TYPE_UINT8_ARRAY -> {
+                byte[] array = new byte[Short.toUnsignedInt(buffer.getShort())];
+                buffer.get(array);
+                data = new Data(tag == TYPE_INT8_ARRAY ? DataType.Int8Array : DataType.UInt8Array, array);
+            }
+            case TYPE_INT16_ARRAY, TYPE_UINT16_ARRAY -> {
+                short[] array = new short[Short.toUnsignedInt(buffer.getShort())];
+                buffer.asShortBuffer().get(array);
+                buffer.position(buffer.position() + array.length * Short.BYTES);
+                data = new Data(tag == TYPE_INT16_ARRAY ? DataType.Int16Array : DataType.UInt16Array, array);
+            }
+            case TYPE_INT32_ARRAY, TYPE_UINT32_ARRAY -> {
+                int[] array = new int[Short.toUnsignedInt(buffer.getShort())];
+                buffer.asIntBuffer().get(array);
+                buffer.position(buffer.position() + array.length * Integer.BYTES);
+                data = new Data(tag == TYPE_INT32_ARRAY ? DataType.Int32Array : DataType.UInt32Array, array);
+            }
+            case TYPE_INT64_ARRAY, TYPE_UINT64_ARRAY -> {
+                long[] array = new long[Short.toUnsignedInt(buffer.getShort())];
+                buffer.asLongBuffer().get(array);
+                buffer.position(buffer.position() + array.length * Long.BYTES);
+                data = new Data(tag == TYPE_INT64_ARRAY ? DataType.Int64Array : DataType.UInt64Array, array);
+            }
+            case TYPE_BOOL_ARRAY -> {
+                boolean[] array = new boolean[Short.toUnsignedInt(buffer.getShort())];
+                byte[] packed = new byte[(array.length + 7) / 8];
+                buffer.get(packed);
+                for (int i = 0; i < array.length; ++i)
+                    array[i] = (packed[i >> 3] >> (i & 7) & 1) != 0;
+                data = new Data(array);
+            }
+            case TYPE_TIME_SERIES -> {
+                // 展開はせず、値の型からビット列までをそのまま保持します。
+                int start = buffer.position();
+                if (buffer.get(start) > 2)
+                    return null;
+                int len = 1 + 2 + 2 + Short.toUnsignedInt(buffer.getShort(start + 3));
+                byte[] payload = new byte[len];
+                buffer.get(payload);
+                data = new Data(DataType.TimeSeries, payload);
+            }
+            case TYPE_VAR_INT16, TYPE_VAR_INT32, TYPE_VAR_INT64, TYPE_VAR_UINT16, TYPE_VAR_UINT32, TYPE_VAR_UINT64 -> {
+                int bits = 16 << (tag - TYPE_VAR_INT16) % 3;
+                Long v = getVarLong(buffer, bits);
+                if (v == null)
+                    return null;
+                data = switch (tag) {
+                    case TYPE_VAR_INT16 -> new Data((short) unzigzag(v));
+                    case TYPE_VAR_INT32 -> new Data((int) unzigzag(v));
+                    case TYPE_VAR_INT64 -> new Data(unzigzag(v));
+                    case TYPE_VAR_UINT16 -> asUInt16((short) (long) v);
+                    case TYPE_VAR_UINT32 -> asUInt32((int) (long) v);
+                    default -> asUInt64(v);
+                };
+            }
             default -> data = null;
         }
         return data;
     }
 
     public static Data deserialize(ByteBuffer buffer) {
+        return deserialize(buffer, null);
+    }
+
+    // 辞書を使用して送信されたデータは、送信元ごとのdictionaryを指定してデシリアライズします。
+    public static Data deserialize(ByteBuffer buffer, StringDictionary dictionary) {
         buffer.order(ByteOrder.LITTLE_ENDIAN);
-        Data data = _deserialize(buffer);
-        return buffer.remaining() == 0 ? data : null;
+        Data data;
+        try {
+            data = _deserialize(buffer, dictionary);
+        } catch (BufferUnderflowException e) {
+            data = null;
+        }
+        boolean valid = data != null && buffer.remaining() == 0;
+        // 途中までの定義は登録せず、正しいパケットの定義だけを登録します。
+        if (dictionary != null)
+            dictionary.commit(valid);
+        return valid ? data : null;
     }
 }
@@ -24,5 +24,29 @@ public enum DataType {
     /** UInt32型 */
     UInt32,
     /** UInt64型 */
-    UInt64
+    UInt64,
+    /** Int8型の数値配列 */
+    Int8Array,
+    /** Int16型の数値配列 */
+    Int16Array,
+    /** Int32型の数値配列 */
+    Int32Array,
+    /** Int64型の数値配列 */
+    Int64Array,
+    /** UInt8型の数値配列 */
+    UInt8Array,
+    /** UInt16型の数値配列 */
+    UInt16Array,
+    /** UInt32型の数値配列 */
+    UInt32Array,
+    /** UInt64型の数値配列 */
+    UInt64Array,
+    /** Float32型 */
+    Float32,
+    /** Float64型 */
+    Float64,
+    /** Bool型の配列（1バイトに8個ずつ格納） */
+    BoolArray,
+    /** 圧縮された時刻と値の組の列（ESP32のTimeSeriesEncoderで構築） */
+    TimeSeries
 }
@@ -0,0 +1,46 @@
+package wireless.data;
+
+import java.util.HashMap;
+import java.util.Map;
+
+/**
+ * 辞書を使用して送信されたデータをデシリアライズするために、一つの送信元から受信した文字列の定義を記録します。
+ */
+public class StringDictionary {
+    /** 受信した定義（key: ID, value: 文字列） */
+    private final Map<Integer, String> entries = new HashMap<>();
+    /** デシリアライズ中のパケットに含まれる定義（パケット全体をデシリアライズできた場合だけentriesに反映します） */
+    private final Map<Integer, String> pending = new HashMap<>();
+    /** 未定義のIDのためにデシリアライズできなかったデータ数 */
+    private int misses = 0;
+
+    void define(int id, String str) {
+        pending.put(id, str);
+    }
+
+    String lookup(int id) {
+        String str = pending.get(id);
+        return str != null ? str : entries.get(id);
+    }
+
+    void miss() {
+        ++misses;
+    }
+
+    void commit(boolean valid) {
+        if (valid)
+            entries.putAll(pending);
+        pending.clear();
+    }
+
+    /**
+     * 定義を受信していないIDのためにデシリアライズできなかったデータ数を取得し、0に戻します。
+     * 
+     * @return デシリアライズできなかったデータ数
+     */
+    public int takeMisses() {
+        int n = misses;
+        misses = 0;
+        return n;
+    }
+}
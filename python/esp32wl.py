@@ -2,6 +2,7 @@ from collections import deque
 from concurrent.futures import ThreadPoolExecutor
 from enum import Enum, auto
 from socket import socket, AF_INET, SOCK_DGRAM
+from struct import pack, unpack_from
 from threading import Lock
 
 
@@ -19,6 +20,25 @@ class DataType(Enum):
     UINT16 = auto()
     UINT32 = auto()
     UINT64 = auto()
+    INT8_ARRAY = auto()
+    INT16_ARRAY = auto()
+    INT32_ARRAY = auto()
+    INT64_ARRAY = auto()
+    UINT8_ARRAY = auto()
+    UINT16_ARRAY = auto()
+    UINT32_ARRAY = auto()
+    UINT64_ARRAY = auto()
+    FLOAT32 = auto()
+    FLOAT64 = auto()
+    BOOL_ARRAY = auto()
+    TIME_SERIES = auto()
+
+
+# 時系列の値の型
+class TimeSeriesType(Enum):
+    FLOAT32 = 0
+    FLOAT64 = 1
+    INT64 = 2
 
 
 TYPE_NULL: int = 0
@@ -34,6 +54,226 @@ TYPE_UINT8: int = 9
 TYPE_UINT16: int = 10
 TYPE_UINT32: int = 11
 TYPE_UINT64: int = 12
+TYPE_INT8_ARRAY: int = 13
+TYPE_INT16_ARRAY: int = 14
+TYPE_INT32_ARRAY: int = 15
+TYPE_INT64_ARRAY: int = 16
+TYPE_UINT8_ARRAY: int = 17
+TYPE_UINT16_ARRAY: int = 18
+TYPE_UINT32_ARRAY: int = 19
+TYPE_UINT64_ARRAY: int = 20
+TYPE_FLOAT32: int = 21
+TYPE_FLOAT64: int = 22
+TYPE_VAR_INT16: int = 23
+TYPE_VAR_INT32: int = 24
+TYPE_VAR_INT64: int = 25
+TYPE_VAR_UINT16: int = 26
+TYPE_VAR_UINT32: int = 27
+TYPE_VAR_UINT64: int = 28
+TYPE_BOOL_ARRAY: int = 29
+TYPE_TIME_SERIES: int = 30
+TYPE_STRING_DEF: int = 31
+TYPE_STRING_REF: int = 32
+
+# 数値配列型の型タグと要素の書式
+ARRAY_FORMATS: dict = {
+    DataType.INT8_ARRAY: (TYPE_INT8_ARRAY, "b"),
+    DataType.INT16_ARRAY: (TYPE_INT16_ARRAY, "h"),
+    DataType.INT32_ARRAY: (TYPE_INT32_ARRAY, "i"),
+    DataType.INT64_ARRAY: (TYPE_INT64_ARRAY, "q"),
+    DataType.UINT8_ARRAY: (TYPE_UINT8_ARRAY, "B"),
+    DataType.UINT16_ARRAY: (TYPE_UINT16_ARRAY, "H"),
+    DataType.UINT32_ARRAY: (TYPE_UINT32_ARRAY, "I"),
+    DataType.UINT64_ARRAY: (TYPE_UINT64_ARRAY, "Q"),
+}
+
+# 可変長整数で書き込む整数型の型タグ、ビット数、符号の有無
+VAR_FORMATS: dict = {
+    DataType.INT16: (TYPE_VAR_INT16, 16, True),
+    DataType.INT32: (TYPE_VAR_INT32, 32, True),
+    DataType.INT64: (TYPE_VAR_INT64, 64, True),
+    DataType.UINT16: (TYPE_VAR_UINT16, 16, False),
+    DataType.UINT32: (TYPE_VAR_UINT32, 32, False),
+    DataType.UINT64: (TYPE_VAR_UINT64, 64, False),
+}
+
+# 時刻の差の差と整数値の差を書き込むビット数（10, 110, 1110, 1111に続くビット数）
+TIME_WIDTHS: tuple = (7, 9, 12, 32)
+INT_WIDTHS: tuple = (8, 16, 32, 64)
+
+
+class BitWriter:
+    def __init__(self) -> None:
+        self.value: int = 0
+        self.bits: int = 0
+
+    def write(self, v: int, n: int) -> None:
+        self.value = (self.value << n) | (v & ((1 << n) - 1))
+        self.bits += n
+
+    def write_bucket(self, v: int, widths: tuple) -> None:
+        if v == 0:
+            self.write(0b0, 1)
+            return
+        i: int = 0
+        while i < 3 and v >> widths[i] != 0:
+            i += 1
+        self.write((1 << (i + 2)) - 2 if i < 3 else 0b1111, i + 2 if i < 3 else 4)
+        self.write(v, widths[i])
+
+    def __bytes__(self) -> bytes:
+        pad: int = -self.bits % 8
+        return (self.value << pad).to_bytes((self.bits + pad) // 8, byteorder="big")
+
+
+class BitReader:
+    def __init__(self, b: bytes) -> None:
+        self.value: int = int.from_bytes(b, byteorder="big")
+        self.size: int = len(b) * 8
+        self.pos: int = 0
+
+    # 読み出すビットが足りない場合はNoneを返します。
+    def read(self, n: int):
+        if self.pos + n > self.size:
+            return None
+        self.pos += n
+        return (self.value >> (self.size - self.pos)) & ((1 << n) - 1)
+
+    def read_bucket(self, widths: tuple):
+        ones: int = 0
+        while ones < 4:
+            bit = self.read(1)
+            if bit is None:
+                return None
+            if bit == 0:
+                break
+            ones += 1
+        return 0 if ones == 0 else self.read(widths[ones - 1])
+
+
+def zigzag(v: int, bits: int) -> int:
+    return ((v << 1) ^ (v >> (bits - 1))) & ((1 << bits) - 1)
+
+
+def unzigzag(v: int) -> int:
+    return (v >> 1) ^ -(v & 1)
+
+
+# 時刻と値の組の列を、ESP32のTimeSeriesEncoderと同じ形式で圧縮します。
+def encode_time_series(type: TimeSeriesType, samples: list) -> bytes:
+    w: BitWriter = BitWriter()
+    width: int = 32 if type is TimeSeriesType.FLOAT32 else 64
+    prev_time = prev_delta = prev_value = 0
+    leading = trailing = None
+    for i, (time, value) in enumerate(samples):
+        time &= 0xFFFFFFFF
+        if i == 0:
+            w.write(time, 32)
+        else:
+            delta: int = (time - prev_time) & 0xFFFFFFFF
+            dod: int = (delta - prev_delta) & 0xFFFFFFFF
+            w.write_bucket(zigzag(dod - (1 << 32) if dod >> 31 else dod, 32), TIME_WIDTHS)
+            prev_delta = delta
+        prev_time = time
+        if type is TimeSeriesType.INT64:
+            d: int = (value - prev_value) & 0xFFFFFFFFFFFFFFFF
+            w.write_bucket(zigzag(d - (1 << 64) if d >> 63 else d, 64), INT_WIDTHS)
+            prev_value = value
+            continue
+        bits: int = int.from_bytes(pack("<f" if width == 32 else "<d", value), byteorder="little")
+        x: int = bits ^ prev_value
+        prev_value = bits
+        if i == 0:
+            w.write(bits, width)
+        elif x == 0:
+            w.write(0b0, 1)
+        else:
+            lead: int = min(width - x.bit_length(), 31)
+            trail: int = (x & -x).bit_length() - 1
+            if leading is not None and lead >= leading and trail >= trailing:
+                w.write(0b10, 2)
+                w.write(x >> trailing, width - leading - trailing)
+            else:
+                length: int = width - lead - trail
+                w.write(0b11, 2)
+                w.write(lead, 5)
+                w.write(length - 1, 6 if width == 64 else 5)
+                w.write(x >> trail, length)
+                leading, trailing = lead, trail
+    return bytes(w)
+
+
+# 圧縮された時刻と値の組の列を展開します。正しくない場合はNoneを返します。
+def decode_time_series(type: TimeSeriesType, count: int, b: bytes):
+    r: BitReader = BitReader(b)
+    width: int = 32 if type is TimeSeriesType.FLOAT32 else 64
+    samples: list = list()
+    time = delta = value = 0
+    leading = trailing = None
+    for i in range(count):
+        if i == 0:
+            time = r.read(32)
+            if time is None:
+                return None
+        else:
+            dod = r.read_bucket(TIME_WIDTHS)
+            if dod is None:
+                return None
+            delta = (delta + unzigzag(dod)) & 0xFFFFFFFF
+            time = (time + delta) & 0xFFFFFFFF
+        if type is TimeSeriesType.INT64:
+            d = r.read_bucket(INT_WIDTHS)
+            if d is None:
+                return None
+            value = (value + unzigzag(d)) & 0xFFFFFFFFFFFFFFFF
+            samples.append((time, value - (1 << 64) if value >> 63 else value))
+            continue
+        if i == 0:
+            value = r.read(width)
+        else:
+            changed = r.read(1)
+            if changed is None:
+                return None
+            if changed == 1:
+                control = r.read(1)
+                if control is None:
+                    return None
+                if control == 0:
+                    if leading is None:
+                        return None
+                    x = r.read(width - leading - trailing)
+                    if x is None:
+                        return None
+                    value ^= x << trailing
+                else:
+                    lead = r.read(5)
+                    length = r.read(6 if width == 64 else 5)
+                    if lead is None or length is None or lead + length + 1 > width:
+                        return None
+                    x = r.read(length + 1)
+                    if x is None:
+                        return None
+                    leading, trailing = lead, width - lead - length - 1
+                    value ^= x << trailing
+        if value is None or r.pos > r.size:
+            return None
+        f: float = unpack_from("<f" if width == 32 else "<d", value.to_bytes(width // 8, byteorder="little"))[0]
+        samples.append((time, f))
+    return samples
+
+
+# 送信側の辞書で割り当てられたIDと文字列の対応
+class StringDictionary:
+    def __init__(self) -> None:
+        self.entries: dict = dict()
+        # デシリアライズ中のパケットに含まれる定義（パケット全体をデシリアライズできた場合だけentriesに反映します）
+        self.pending: dict = dict()
+        # 未定義のIDのためにデシリアライズできなかったデータ数
+        self.misses: int = 0
+
+    def lookup(self, id: int):
+        s = self.pending.get(id)
+        return s if s is not None else self.entries.get(id)
 
 
 class Data:
@@ -50,7 +290,7 @@ class Data:
         return self.__data
 
     @staticmethod
-    def __deserialize(b: bytearray):
+    def __deserialize(b: bytearray, dictionary: StringDictionary):
         if len(b) == 0:
             return None
         t: int = b.pop(0)
@@ -70,6 +310,27 @@ class Data:
             s: str = b[:l].decode()
             del b[:l]
             return Data(DataType.STRING, s)
+        elif t == TYPE_STRING_DEF:
+            if dictionary is None or len(b) < 3:
+                return None
+            id: int = b[0]
+            l = int.from_bytes(b[1:3], byteorder="little", signed=False)
+            del b[:3]
+            if len(b) < l:
+                return None
+            s: str = b[:l].decode()
+            del b[:l]
+            dictionary.pending[id] = s
+            return Data(DataType.STRING, s)
+        elif t == TYPE_STRING_REF:
+            if dictionary is None or len(b) < 1:
+                return None
+            id: int = b.pop(0)
+            s = dictionary.lookup(id)
+            if s is None:
+                dictionary.misses += 1
+                return None
+            return Data(DataType.STRING, s)
         elif t == TYPE_ARRAY:
             if len(b) < 2:
                 return None
@@ -77,7 +338,7 @@ class Data:
             del b[:2]
             ary: list = list()
             for _ in range(l):
-                elem = Data.__deserialize(b)
+                elem = Data.__deserialize(b, dictionary)
                 if elem is None:
                     return None
                 ary.append(elem)
@@ -130,17 +391,102 @@ class Data:
             i: int = int.from_bytes(b[:8], byteorder="little", signed=False)
             del b[:8]
             return Data(DataType.UINT64, i)
+        elif t == TYPE_FLOAT32:
+            if len(b) < 4:
+                return None
+            f: float = unpack_from("<f", b)[0]
+            del b[:4]
+            return Data(DataType.FLOAT32, f)
+        elif t == TYPE_FLOAT64:
+            if len(b) < 8:
+                return None
+            f: float = unpack_from("<d", b)[0]
+            del b[:8]
+            return Data(DataType.FLOAT64, f)
+        elif t == TYPE_BOOL_ARRAY:
+            if len(b) < 2:
+                return None
+            l = int.from_bytes(b[:2], byteorder="little", signed=False)
+            del b[:2]
+            size: int = (l + 7) // 8
+            if len(b) < size:
+                return None
+            flags: list = [(b[i >> 3] >> (i & 7)) & 1 == 1 for i in range(l)]
+            del b[:size]
+            return Data(DataType.BOOL_ARRAY, flags)
+        elif t == TYPE_TIME_SERIES:
+            if len(b) < 5 or b[0] > TimeSeriesType.INT64.value:
+                return None
+            type = TimeSeriesType(b[0])
+            count = int.from_bytes(b[1:3], byteorder="little", signed=False)
+            size = int.from_bytes(b[3:5], byteorder="little", signed=False)
+            del b[:5]
+            if len(b) < size:
+                return None
+            samples = decode_time_series(type, count, bytes(b[:size]))
+            del b[:size]
+            if samples is None:
+                return None
+            return Data(DataType.TIME_SERIES, (type, samples))
+        for type, (tag, bits, signed) in VAR_FORMATS.items():
+            if t == tag:
+                v: int = 0
+                for i in range(0, bits, 7):
+                    if len(b) == 0:
+                        return None
+                    c: int = b.pop(0)
+                    v |= (c & 0x7F) << i
+                    if c & 0x80 == 0:
+                        break
+                else:
+                    return None
+                if v >> bits != 0:
+                    return None
+                return Data(type, (v >> 1) ^ -(v & 1) if signed else v)
+        for type, (tag, fmt) in ARRAY_FORMATS.items():
+            if t == tag:
+                if len(b) < 2:
+                    return None
+                l = int.from_bytes(b[:2], byteorder="little", signed=False)
+                del b[:2]
+                size: int = l << (t - TYPE_INT8_ARRAY) % 4
+                if len(b) < size:
+                    return None
+                values: list = list(unpack_from(f"<{l}{fmt}", b))
+                del b[:size]
+                return Data(type, values)
         return None
 
     @staticmethod
-    def deserialize(b: bytes):
+    # 辞書を使用して送信されたデータは、送信元ごとのdictionaryを指定してデシリアライズします。
+    def deserialize(b: bytes, dictionary: StringDictionary = None):
         bary = bytearray(b)
-        data: Data = Data.__deserialize(bary)
-        return data if len(bary) == 0 else None
+        data: Data = Data.__deserialize(bary, dictionary)
+        valid: bool = data is not None and len(bary) == 0
+        # 途中までの定義は登録せず、正しいパケットの定義だけを登録します。
+        if dictionary is not None:
+            if valid:
+                dictionary.entries.update(dictionary.pending)
+            dictionary.pending.clear()
+        return data if valid else None
 
     def __bytes__(self):
+        return self.serialize()
+
+    # compactがTrueの場合は16bit以上の整数を可変長整数（符号付きはZigZag符号化）で書き込みます。
+    def serialize(self, compact: bool = False) -> bytes:
         bs: bytearray = bytearray()
-        if self.__type is DataType.NULL:
+        if compact and self.__type in VAR_FORMATS:
+            tag, bits, signed = VAR_FORMATS[self.__type]
+            bs.append(tag)
+            self.__data: int
+            v: int = (self.__data << 1) ^ (self.__data >> (bits - 1)) if signed else self.__data
+            v &= (1 << bits) - 1
+            while v >= 0x80:
+                bs.append(v & 0x7F | 0x80)
+                v >>= 7
+            bs.append(v)
+        elif self.__type is DataType.NULL:
             bs.append(TYPE_NULL)
         elif self.__type is DataType.BOOL:
             bs.append(TYPE_TRUE if self.__data else TYPE_FALSE)
@@ -156,7 +502,7 @@ class Data:
             bs += len(self.__data).to_bytes(2,
                                             byteorder="little", signed=False)
             for d in self.__data:
-                bs += bytes(d)
+                bs += d.serialize(compact)
         elif self.__type is DataType.INT8:
             bs.append(TYPE_INT8)
             self.__data: int
@@ -189,6 +535,41 @@ class Data:
             bs.append(TYPE_UINT64)
             self.__data: int
             bs += self.__data.to_bytes(8, byteorder="little", signed=False)
+        elif self.__type is DataType.FLOAT32:
+            bs.append(TYPE_FLOAT32)
+            self.__data: float
+            bs += pack("<f", self.__data)
+        elif self.__type is DataType.FLOAT64:
+            bs.append(TYPE_FLOAT64)
+            self.__data: float
+            bs += pack("<d", self.__data)
+        elif self.__type is DataType.BOOL_ARRAY:
+            # 1バイトに8個ずつ下位ビットから詰めて書き込みます。
+            bs.append(TYPE_BOOL_ARRAY)
+            self.__data: list
+            bs += len(self.__data).to_bytes(2,
+                                            byteorder="little", signed=False)
+            packed: bytearray = bytearray((len(self.__data) + 7) // 8)
+            for i, flag in enumerate(self.__data):
+                if flag:
+                    packed[i >> 3] |= 1 << (i & 7)
+            bs += packed
+        elif self.__type is DataType.TIME_SERIES:
+            # データは値の型と、時刻と値の組のリストです。
+            type, samples = self.__data
+            packed: bytes = encode_time_series(type, samples)
+            bs.append(TYPE_TIME_SERIES)
+            bs.append(type.value)
+            bs += len(samples).to_bytes(2, byteorder="little", signed=False)
+            bs += len(packed).to_bytes(2, byteorder="little", signed=False)
+            bs += packed
+        elif self.__type in ARRAY_FORMATS:
+            tag, fmt = ARRAY_FORMATS[self.__type]
+            bs.append(tag)
+            self.__data: list
+            bs += len(self.__data).to_bytes(2,
+                                            byteorder="little", signed=False)
+            bs += pack(f"<{len(self.__data)}{fmt}", *self.__data)
         else:
             raise ValueError()
         return bytes(bs)
@@ -215,11 +596,19 @@ class Data:
             else -1
         )
 
+    def __float__(self) -> float:
+        return (
+            self.data
+            if self.__type is DataType.FLOAT32 or self.__type is DataType.FLOAT64
+            else float("nan")
+        )
+
     def __iter__(self):
-        return self.data if self.__type is DataType.ARRAY else list()
+        return iter(self.data if self.__type is DataType.ARRAY or self.__type in ARRAY_FORMATS else list())
 
 
-MAX_PACKET_SIZE: int = 256
+# UDPで受信可能な最大バイト数
+MAX_PACKET_SIZE: int = 65507
 
 
 class Wireless:
@@ -231,6 +620,7 @@ class Wireless:
         self.__rx_bufs: dict = dict()
         self.__tx_channels: dict = dict()
         self.__rx_channels: dict = dict()
+        self.__rx_misses: dict = dict()
 
     def tx_attach(self, ip: str, port: int, channel: int) -> None:
         adr: tuple = (ip, port)
@@ -249,12 +639,19 @@ class Wireless:
     def __rx_loop(self, port: int) -> None:
         s: socket = socket(AF_INET, SOCK_DGRAM)
         s.bind(("0.0.0.0", port))
+        # 送信元のIPアドレスごとの辞書
+        dictionaries: dict = dict()
         while self.__rx_flag:
-            b, _ = s.recvfrom(MAX_PACKET_SIZE)
-            data = Data.deserialize(b)
+            b, adr = s.recvfrom(MAX_PACKET_SIZE)
+            dictionary: StringDictionary = dictionaries.setdefault(adr[0], StringDictionary())
+            data = Data.deserialize(b, dictionary)
+            misses: int = dictionary.misses
+            dictionary.misses = 0
             with self.__lock:
                 if port in self.__rx_channels.keys():
                     channels: set = self.__rx_channels[port]
+                    for channel in channels:
+                        self.__rx_misses[channel] = self.__rx_misses.get(channel, 0) + misses
                     for channel in channels:
                         buf: deque
                         if channel in self.__rx_bufs:
@@ -288,15 +685,20 @@ class Wireless:
                     return rx_buf.popleft()
         return None
 
+    # 定義を受信していない辞書のIDを含むため受信できなかったデータ数を取得し、0に戻します。
+    def dictionary_misses(self, channel: int = 0) -> int:
+        with self.__lock:
+            return self.__rx_misses.pop(channel, 0)
+
     def available(self, channel: int = 0) -> int:
         with self.__lock:
             if channel in self.__rx_bufs.keys():
                 return len(self.__rx_bufs[channel])
         return 0
 
-    def write(self, data: Data, channel: int = 0):
+    def write(self, data: Data, channel: int = 0, compact: bool = False):
         if channel in self.__tx_channels.keys():
-            b: bytes = bytes(data)
+            b: bytes = data.serialize(compact)
             for adr in self.__tx_channels[channel]:
                 self.__socket.sendto(b, adr)
 
@@ -312,6 +714,7 @@ class Wireless:
         self.__socket.close()
         self.__rx_bufs.clear()
         self.__rx_channels.clear()
+        self.__rx_misses.clear()
         self.__rx_thread_pool.shutdown()
         self.__tx_channels.clear()
         self.__lock = None
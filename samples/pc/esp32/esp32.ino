@@ -1,5 +1,7 @@
 #include "Wireless.hpp"
 
+static constexpr auto HELLO = encodeLiteral("Hello. I'm esp32");
+
 void setup() {
   Serial.begin(9600);
 
@@ -27,7 +29,7 @@ void loop() {
     Serial.print(msg);
     Serial.println('"');
   }
-  wlTxWrite("Hello. I'm esp32", 0);
+  wlTxWrite(HELLO, 0);
   Serial.println("sent (ch0): \"Hello. I'm esp32\"");
 
   if (b2 = wlRxAvailable(1) > 0) {
@@ -53,7 +55,8 @@ void loop() {
     Serial.println(val);
   }
   if (b4 = wlRxAvailable(3) > 0) {
-    std::vector<Data> ary = wlRxRead(3);
+    Data data = wlRxRead(3);
+    const DataArray& ary = data.asArray();
     Serial.print("received (ch3): [");
     Serial.print(ary[0] ? "true" : "false");
     Serial.print(", ");
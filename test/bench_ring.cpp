@@ -0,0 +1,105 @@
+/*
+  受信タスクから読み出し側へデータを受け渡すまでの遅延を計測します。
+  以前の受信バッファ（portMUXのフラグを取得できるまでdelay(1)で待つ排他とstd::queue）と、
+  DataRingを比較し、中央値（p50）と99パーセンタイル（p99）を表示します。
+*/
+#include "DataRing.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <queue>
+#include <thread>
+#include <vector>
+
+static const int MESSAGES = 200000;  // 受け渡すデータ数
+
+// 以前の受信バッファの排他（Wireless.cppのmutEnterとmutExit）
+static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool mux_flag = false;
+
+static void mutEnter() {
+  for (;;) {
+    bool got;
+    portENTER_CRITICAL(&mux);
+    if (!mux_flag) {
+      mux_flag = true;
+      got = true;
+    } else
+      got = false;
+    portEXIT_CRITICAL(&mux);
+    if (got)
+      return;
+    delay(1);
+  }
+}
+
+static void mutExit() {
+  portENTER_CRITICAL(&mux);
+  mux_flag = false;
+  portEXIT_CRITICAL(&mux);
+}
+
+static int64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+  受信タスクの代わりに追加したときの時刻をデータとして追加し、読み出し側で取り出すまでの時間を記録します。
+  受信の間隔を空けるため、8個ごとに2マイクロ秒待ちます。
+*/
+template<class Push, class Pop>
+static void run(const char* name, Push push, Pop pop) {
+  std::vector<int64_t> latencies;
+  latencies.reserve(MESSAGES);
+  std::atomic<bool> done(false);
+  std::thread reader([&] {
+    Data data;
+    for (;;) {
+      bool finished = done.load();
+      while (pop(data))
+        latencies.push_back(now() - static_cast<int64_t>(data));
+      if (finished)
+        break;
+    }
+  });
+  for (int i = 0; i < MESSAGES; ++i) {
+    Data data = now();
+    push(data);
+    if (i % 8 == 0)
+      std::this_thread::sleep_for(std::chrono::microseconds(2));
+  }
+  done.store(true);
+  reader.join();
+  std::sort(latencies.begin(), latencies.end());
+  printf("%-22s n=%zu  p50 %8.1f us  p99 %8.1f us  max %8.1f us\n", name, latencies.size(),
+         latencies[latencies.size() / 2] / 1000.0, latencies[latencies.size() * 99 / 100] / 1000.0, latencies.back() / 1000.0);
+}
+
+int main() {
+  std::queue<Data> queue;
+  run("mutEnter + std::queue", [&](Data& data) {
+    mutEnter();
+    queue.push(std::move(data));
+    mutExit();
+  }, [&](Data& data) {
+    mutEnter();
+    bool popped = !queue.empty();
+    if (popped) {
+      data = std::move(queue.front());
+      queue.pop();
+    }
+    mutExit();
+    return popped;
+  });
+
+  DataRing ring(1024);
+  run("DataRing", [&](Data& data) {
+    while (!ring.push(data))
+      std::this_thread::yield();
+  }, [&](Data& data) {
+    return ring.pop(&data);
+  });
+  return 0;
+}
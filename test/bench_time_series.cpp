@@ -0,0 +1,83 @@
+/*
+  時系列の圧縮について、1組あたりのバイト数と、圧縮と展開にかかる時間を計測します。
+  比較のため、時刻（uint32_t）と値を並べただけの場合の1組あたりのバイト数も表示します。
+  記録したセンサーの値ではなく、正弦波と乱数（mt19937）で作った合成データを使用するため、
+  1組あたりのバイト数は実際のセンサーの値での圧縮率の目安にすぎません。
+*/
+#include "TimeSeries.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static const int N = 1000;       // 1つの時系列の組の数
+static const int ROUNDS = 200;   // 時間を計測する繰り返し回数
+
+template<class T>
+struct Workload {
+  const char* name;
+  TimeSeriesType type;
+  std::vector<uint32_t> times;
+  std::vector<T> values;
+};
+
+static double nanosPerSample(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (static_cast<double>(N) * ROUNDS);
+}
+
+template<class T>
+static void run(const Workload<T>& w) {
+  TimeSeriesEncoder encoder(w.type);
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < ROUNDS; ++round) {
+    encoder.reset();
+    for (int i = 0; i < N; ++i)
+      encoder.append(w.times[i], w.values[i]);
+  }
+  double encode = nanosPerSample(start);
+  Data data = encoder.toData();
+
+  volatile uint64_t sink = 0;
+  start = std::chrono::steady_clock::now();
+  for (int round = 0; round < ROUNDS; ++round) {
+    TimeSeriesDecoder decoder(data);
+    uint32_t time;
+    T value;
+    while (decoder.next(&time, &value))
+      sink = sink + time;
+  }
+  double decode = nanosPerSample(start);
+
+  printf("%-22s %6.2f B/sample (plain %2zu)  encode %6.1f ns/sample  decode %6.1f ns/sample\n",
+         w.name, static_cast<double>(data.serializedSize()) / N, sizeof(uint32_t) + sizeof(T), encode, decode);
+}
+
+int main() {
+  std::mt19937 rng(1);
+  Workload<float> temperature{ "float32 temperature", TimeSeriesType::Float32, {}, {} };
+  Workload<float> noise{ "float32 noise", TimeSeriesType::Float32, {}, {} };
+  Workload<double> position{ "float64 position", TimeSeriesType::Float64, {}, {} };
+  Workload<int64_t> counter{ "int64 encoder ticks", TimeSeriesType::Int64, {}, {} };
+  std::normal_distribution<float> normal(0.0f, 1.0f);
+  uint32_t time = 0;
+  int64_t ticks = 0;
+  for (int i = 0; i < N; ++i) {
+    // 10ミリ秒ごとの記録で、ときどき1ミリ秒ずれます。
+    time += 10 + (rng() % 10 == 0 ? 1 : 0);
+    float celsius = std::round((20.0f + 2.0f * std::sin(i * 0.01f)) * 10) / 10;
+    ticks += 40 + static_cast<int64_t>(rng() % 5);
+    for (auto* times : { &temperature.times, &noise.times, &position.times, &counter.times })
+      times->push_back(time);
+    temperature.values.push_back(celsius);
+    noise.values.push_back(normal(rng));
+    position.values.push_back(i * 0.25);
+    counter.values.push_back(ticks);
+  }
+  run(temperature);
+  run(noise);
+  run(position);
+  run(counter);
+  return 0;
+}
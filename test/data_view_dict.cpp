@@ -0,0 +1,51 @@
+/*
+  辞書を使用してシリアライズしたデータを、DataViewで文字列の定義とIDを読み飛ばしながら参照できることを確認します。
+*/
+#include "DataDictionary.hpp"
+#include "DataView.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+int main() {
+  DataDictionary sender;
+  sender.add("temperature");
+  sender.add("humidity");
+  Data message{ "temperature", (int16_t)215, "humidity", (uint8_t)40, "temperature" };
+
+  // 1回目は定義とID、2回目はIDだけになります。
+  std::vector<uint8_t> first, second;
+  assert(message.serialize(first, DataEncoding::Fixed, sender) != 0);
+  assert(message.serialize(second, DataEncoding::Fixed, sender) != 0);
+
+  // 辞書を指定しない場合も定義は文字列として参照でき、IDを含む要素も読み飛ばせます。
+  DataView plain(first.data(), first.size());
+  assert(plain.valid() && plain.encodedSize() == first.size() && plain.size() == 5);
+  assert(plain[0].type() == DataType::String && plain[0] == "temperature" && plain[0].size() == 11);
+  assert((int16_t)plain[1] == 215 && plain[2] == "humidity" && (uint8_t)plain[3] == 40);
+  assert(plain[4].valid() && plain[4].type() == DataType::Null && plain[4].chars() == nullptr);
+
+  // 辞書を指定するとIDは辞書の文字列を参照します。
+  DataDictionary receiver;
+  DataView first_view(first.data(), first.size(), receiver);
+  assert(first_view[4].type() == DataType::Null);  // まだ定義を登録していません
+  assert(first_view.toData() == message);
+  DataView second_view(second.data(), second.size(), receiver);
+  assert(second_view.valid() && second_view.encodedSize() == second.size());
+  size_t index = 0;
+  for (const DataView& item : second_view) {
+    if (index % 2 == 0) {
+      assert(item.type() == DataType::String && item == message.at(index).asString());
+      assert(item.size() == strlen(message.at(index).asString()) && String(item) == message.at(index).asString());
+    }
+    ++index;
+  }
+  assert(index == 5);
+  assert(second_view.toData() == message);
+
+  // 途中で切れた定義は正しくないデータとして扱います。
+  for (size_t size = 0; size < first.size(); ++size)
+    assert(!DataView(first.data(), size, receiver).valid());
+  return 0;
+}
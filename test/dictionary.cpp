@@ -0,0 +1,84 @@
+/*
+  辞書の文字列の検索と再定義、受信ポートごとに保持する送信元の辞書の数の上限と、
+  送信チャンネルに後から接続した宛先にも定義を送ることを確認します。
+*/
+#include "DataDictionary.hpp"
+#include "Wireless.hpp"
+
+#include <cassert>
+#include <string>
+#include <vector>
+
+int main() {
+  // 登録できる数まで、同じ文字列には同じIDを返します。
+  DataDictionary dict;
+  std::vector<std::string> names;
+  for (size_t i = 0; i < DataDictionary::MAX_ENTRIES; ++i) {
+    names.push_back("sensor/" + std::to_string(i));
+    assert(dict.add(names.back().c_str()) == static_cast<int>(i));
+  }
+  for (size_t i = 0; i < names.size(); ++i)
+    assert(dict.add(names[i].c_str()) == static_cast<int>(i) && dict.at(i) == names[i].c_str());
+  assert(dict.add("one too many") == -1 && dict.size() == DataDictionary::MAX_ENTRIES);
+  dict.clear();
+  assert(dict.size() == 0 && dict.add("sensor/7") == 0);
+
+  // 受信した定義で別の文字列に置き換えられたIDは、古い文字列では見つかりません。
+  DataDictionary first, second, receiver;
+  first.add("left");
+  first.add("right");
+  second.add("up");
+  std::vector<uint8_t> buf;
+  Data received;
+  Data{ "left", "right" }.serialize(buf, DataEncoding::Fixed, first);
+  assert(Data::deserialize(buf.data(), buf.size(), &received, receiver));
+  buf.clear();
+  Data{ "up" }.serialize(buf, DataEncoding::Fixed, second);
+  assert(Data::deserialize(buf.data(), buf.size(), &received, receiver));
+  assert(receiver.at(0) == "up" && receiver.add("up") == 0 && receiver.add("right") == 1);
+  assert(receiver.add("left") == 2);
+
+  // 送信元の辞書は上限の数だけ保持し、最も長く受信していない送信元の辞書から削除します。
+  wlRxAttach(7000, 1);
+  DataDictionary sender;
+  sender.add("status");
+  std::vector<uint8_t> definition, reference;
+  Data message{ "status", (int32_t)1 };
+  message.serialize(definition, DataEncoding::Fixed, sender);
+  message.serialize(reference, DataEncoding::Fixed, sender);
+  auto source = [](int i) {
+    return IPAddress(10, 0, i / 256, i % 256);
+  };
+  for (int i = 0; i <= WL_RX_DICTIONARIES; ++i) {
+    inject(7000, definition.data(), definition.size(), source(i));
+    assert(wlRxRead(1) == message);
+    // 最初の送信元は受信し続けるため削除されません。
+    inject(7000, reference.data(), reference.size(), source(0));
+    assert(wlRxRead(1) == message);
+  }
+  assert(wlRxDictionaryMisses(1) == 0);
+  inject(7000, reference.data(), reference.size(), source(1));
+  assert(wlRxAvailable(1) == 0 && wlRxDictionaryMisses(1) == 1);
+  inject(7000, reference.data(), reference.size(), source(WL_RX_DICTIONARIES));
+  assert(wlRxRead(1) == message);
+
+  // 定義を送信した後に接続した宛先も、次の送信で定義を受信します。
+  wlTxAttach(IPAddress(192, 168, 1, 3), 7001, 2);
+  wlTxDictionaryAdd("status", 2);
+  g_sent.clear();
+  assert(wlTxWrite(message, 2) && wlTxWrite(message, 2));
+  assert(g_sent.size() == 2 && g_sent[0].bytes == definition && g_sent[1].bytes == reference);
+  wlTxAttach(IPAddress(192, 168, 1, 4), 7001, 2);
+  g_sent.clear();
+  assert(wlTxWrite(message, 2));
+  assert(g_sent.size() == 2);
+  for (const SentPacket& packet : g_sent) {
+    DataDictionary fresh;
+    assert(Data::deserialize(packet.bytes.data(), packet.bytes.size(), &received, fresh) && received == message);
+  }
+  // 接続済みの宛先を再度接続しても送り直しません。
+  wlTxAttach(IPAddress(192, 168, 1, 4), 7001, 2);
+  g_sent.clear();
+  assert(wlTxWrite(message, 2) && g_sent.size() == 2 && g_sent[1].bytes == reference);
+  return 0;
+}
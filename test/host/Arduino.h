@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include <utility>
+#include <map>
+
+class String {
+  std::string s;
+public:
+  String(const char* c = "") : s(c ? c : "") {}
+  String(const char* c, unsigned int n) : s(c, n) {}
+  String(const String&) = default;
+  String(String&&) = default;
+  String& operator=(const String&) = default;
+  String& operator=(String&&) = default;
+  explicit String(int v) : s(std::to_string(v)) {}
+  unsigned int length() const { return s.size(); }
+  char operator[](unsigned int i) const { return s[i]; }
+  bool reserve(unsigned int n) { s.reserve(n); return true; }
+  bool concat(char c) { s.push_back(c); return true; }
+  bool concat(const char* c, unsigned int n) { s.append(c, n); return true; }
+  const char* c_str() const { return s.c_str(); }
+  bool operator==(const String& o) const { return s == o.s; }
+  bool operator==(const char* o) const { return s == o; }
+  bool operator!=(const String& o) const { return s != o.s; }
+};
+
+inline void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline unsigned long millis() { using namespace std::chrono; return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count(); }
+inline unsigned long micros() { using namespace std::chrono; return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count(); }
+
+// FreeRTOS-ish
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xFFFFFFFFu
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portTICK_PERIOD_MS 1
+struct portMUX_TYPE { std::recursive_mutex m; };
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portENTER_CRITICAL(x) (x)->m.lock()
+#define portEXIT_CRITICAL(x) (x)->m.unlock()
+#define portENTER_CRITICAL_ISR(x) (x)->m.lock()
+#define portEXIT_CRITICAL_ISR(x) (x)->m.unlock()
+#define tskNO_AFFINITY 0x7FFFFFFF
+struct tskTaskControlBlock;
+typedef tskTaskControlBlock* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char*, uint32_t, void*, UBaseType_t, TaskHandle_t*, BaseType_t);
+void vTaskDelete(TaskHandle_t);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+BaseType_t xTaskNotifyGive(TaskHandle_t);
+uint32_t ulTaskNotifyTake(BaseType_t, TickType_t);
+BaseType_t xTaskNotify(TaskHandle_t, uint32_t, int);
+BaseType_t xTaskNotifyWait(uint32_t, uint32_t, uint32_t*, TickType_t);
+TickType_t xTaskGetTickCount();
+void vTaskDelay(TickType_t);
+struct QueueDefinition;
+typedef QueueDefinition* SemaphoreHandle_t;
+SemaphoreHandle_t xSemaphoreCreateBinary();
+BaseType_t xSemaphoreGive(SemaphoreHandle_t);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t);
+void vSemaphoreDelete(SemaphoreHandle_t);
+#define eSetBits 1
+#define eNoAction 0
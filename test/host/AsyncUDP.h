@@ -0,0 +1,30 @@
+#pragma once
+#include "IPAddress.h"
+#include <vector>
+class AsyncUDPPacket {
+public:
+  const uint8_t* d; size_t n; IPAddress ip = IPAddress(192,168,1,2);
+  IPAddress remoteIP() { return ip; }
+  uint8_t* data() { return const_cast<uint8_t*>(d); }
+  size_t length() { return n; }
+};
+typedef std::function<void(AsyncUDPPacket&)> AuPacketHandlerFunction;
+struct SentPacket { std::vector<uint8_t> bytes; IPAddress ip; uint16_t port; };
+extern std::vector<SentPacket> g_sent;
+// falseの場合は送信したパケットを記録せず、数だけを数えます（メモリを確保しません）。
+extern bool g_record_sent;
+extern size_t g_sent_count;
+class AsyncUDP;
+inline std::map<uint16_t, AsyncUDP*>& listeners_() { static auto* m = new std::map<uint16_t, AsyncUDP*>(); return *m; }
+#define g_listeners listeners_()
+class AsyncUDP {
+public:
+  AuPacketHandlerFunction h;
+  uint16_t port = 0;
+  ~AsyncUDP() { if (port && g_listeners[port] == this) g_listeners.erase(port); }
+  bool listen(uint16_t p) { port = p; g_listeners[p] = this; return true; }
+  void onPacket(AuPacketHandlerFunction f) { h = f; }
+  void close() { if (port && g_listeners[port] == this) g_listeners.erase(port); port = 0; }
+  size_t writeTo(const uint8_t* b, size_t n, const IPAddress& ip, uint16_t port) { ++g_sent_count; if (g_record_sent) g_sent.push_back({ std::vector<uint8_t>(b, b + n), ip, port }); return n; }
+};
+inline void inject(uint16_t port, const uint8_t* b, size_t n, IPAddress ip = IPAddress(192,168,1,2)) { auto it = g_listeners.find(port); if (it != g_listeners.end() && it->second->h) { AsyncUDPPacket p{ b, n, ip }; it->second->h(p); } }
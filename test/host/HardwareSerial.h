@@ -0,0 +1,5 @@
+#pragma once
+#include "Arduino.h"
+class Stream { public: virtual ~Stream() {} };
+class HardwareSerial : public Stream { public: void begin(unsigned long) {} void end() {} };
+extern HardwareSerial Serial;
@@ -0,0 +1,11 @@
+#pragma once
+#include "Arduino.h"
+class IPAddress {
+  uint32_t a = 0;
+public:
+  IPAddress() {}
+  IPAddress(uint8_t x, uint8_t y, uint8_t z, uint8_t w) : a(x | (y << 8) | (z << 16) | ((uint32_t)w << 24)) {}
+  bool operator==(const IPAddress& o) const { return a == o.a; }
+  bool operator!=(const IPAddress& o) const { return a != o.a; }
+  operator uint32_t() const { return a; }
+};
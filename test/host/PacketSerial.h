@@ -0,0 +1,12 @@
+#pragma once
+#include "HardwareSerial.h"
+class PacketSerial {
+public:
+  typedef void (*PacketHandlerFunction)(const uint8_t*, size_t);
+  void setStream(Stream*) {}
+  void setPacketHandler(PacketHandlerFunction f) { handler = f; }
+  void update() {}
+  void send(const uint8_t* b, size_t n) { last.assign(b, b + n); }
+  PacketHandlerFunction handler = nullptr;
+  std::basic_string<uint8_t> last;
+};
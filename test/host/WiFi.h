@@ -0,0 +1,12 @@
+#pragma once
+#include "IPAddress.h"
+#define WL_CONNECTED 3
+struct WiFiClass {
+  bool config(IPAddress, IPAddress, IPAddress) { return true; }
+  void begin(const char*, const char*) {}
+  int status() { return WL_CONNECTED; }
+  bool softAP(const char*, const char*) { return true; }
+  bool softAPConfig(IPAddress, IPAddress, IPAddress) { return true; }
+  bool disconnect(bool, bool) { return true; }
+};
+extern WiFiClass WiFi;
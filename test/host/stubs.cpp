@@ -0,0 +1,140 @@
+/*
+  ホストでテストを実行するための、ESP32のライブラリの最小限の代替実装です。
+  FreeRTOSのタスクはstd::threadで、タスク通知とセマフォはstd::condition_variableで置き換えます。
+  タスク通知はarduino-esp32の既定の設定と同じく、タスクごとに1つだけです。
+*/
+#include "Arduino.h"
+#include "AsyncUDP.h"
+#include "HardwareSerial.h"
+#include "WiFi.h"
+
+#include <memory>
+#include <vector>
+
+HardwareSerial Serial;
+WiFiClass WiFi;
+std::vector<SentPacket> g_sent;
+bool g_record_sent = true;
+size_t g_sent_count = 0;
+
+struct tskTaskControlBlock {
+  std::mutex m;
+  std::condition_variable cv;
+  uint32_t value = 0;
+  bool pending = false;
+};
+
+static thread_local tskTaskControlBlock* self_tcb = nullptr;
+
+// 終了時に待機中のスレッドが参照しないように、タスクの状態は解放しません。
+static std::mutex tcbs_mutex;
+static std::vector<std::unique_ptr<tskTaskControlBlock>>& tcbs = *new std::vector<std::unique_ptr<tskTaskControlBlock>>;
+
+static tskTaskControlBlock* newTcb() {
+  tskTaskControlBlock* tcb = new tskTaskControlBlock();
+  std::lock_guard<std::mutex> lock(tcbs_mutex);
+  tcbs.emplace_back(tcb);
+  return tcb;
+}
+
+static std::chrono::milliseconds toDuration(TickType_t ticks) {
+  return std::chrono::milliseconds(ticks == portMAX_DELAY ? 1000000000u : ticks);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  if (self_tcb == nullptr)
+    self_tcb = newTcb();
+  return self_tcb;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t f, const char*, uint32_t, void* arg, UBaseType_t, TaskHandle_t* handle, BaseType_t) {
+  tskTaskControlBlock* tcb = newTcb();
+  if (handle != nullptr)
+    *handle = tcb;
+  std::thread([f, arg, tcb] {
+    self_tcb = tcb;
+    f(arg);
+  }).detach();
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t) {}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t t) {
+  std::lock_guard<std::mutex> lock(t->m);
+  ++t->value;
+  t->cv.notify_all();
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+  tskTaskControlBlock* t = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> lock(t->m);
+  t->cv.wait_for(lock, toDuration(ticks), [t] { return t->value != 0; });
+  uint32_t value = t->value;
+  if (clear)
+    t->value = 0;
+  else if (value != 0)
+    --t->value;
+  return value;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t t, uint32_t bits, int action) {
+  std::lock_guard<std::mutex> lock(t->m);
+  if (action == eSetBits)
+    t->value |= bits;
+  t->pending = true;
+  t->cv.notify_all();
+  return pdPASS;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t* value_p, TickType_t ticks) {
+  tskTaskControlBlock* t = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> lock(t->m);
+  t->value &= ~clear_on_entry;
+  bool notified = t->cv.wait_for(lock, toDuration(ticks), [t] { return t->pending; });
+  if (value_p != nullptr)
+    *value_p = t->value;
+  t->pending = false;
+  t->value &= ~clear_on_exit;
+  return notified ? pdTRUE : pdFALSE;
+}
+
+struct QueueDefinition {
+  std::mutex m;
+  std::condition_variable cv;
+  bool given = false;
+};
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+  return new QueueDefinition();
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) {
+  std::lock_guard<std::mutex> lock(s->m);
+  if (s->given)
+    return pdFALSE;
+  s->given = true;
+  s->cv.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks) {
+  std::unique_lock<std::mutex> lock(s->m);
+  if (!s->cv.wait_for(lock, toDuration(ticks), [s] { return s->given; }))
+    return pdFALSE;
+  s->given = false;
+  return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t s) {
+  delete s;
+}
+
+TickType_t xTaskGetTickCount() {
+  return millis();
+}
+
+void vTaskDelay(TickType_t ticks) {
+  delay(ticks);
+}
@@ -0,0 +1,70 @@
+/*
+  RxMailboxが最新の値とバージョンを返し、上書きされた値を数えることと、
+  格納と読み出しを別のスレッドから同時に行っても、格納したときの値とバージョンの組が崩れないことを確認します。
+*/
+#include "RxMailbox.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <thread>
+#include <vector>
+
+// バージョンと対応する値（ヒープ上に確保する長さの文字列を含めます）
+static Data message(uint32_t version) {
+  return Data{ static_cast<int64_t>(version), "a value that does not fit inline" };
+}
+
+int main() {
+  RxMailbox mailbox;
+  Data data;
+  assert(!mailbox.fresh() && !mailbox.take(&data) && mailbox.latest(&data) == 0 && data.type() == DataType::Null);
+
+  for (uint32_t version = 1; version <= 5; ++version) {
+    Data value = message(version);
+    mailbox.store(value);
+  }
+  assert(mailbox.fresh() && mailbox.dropped() == 4 && mailbox.dropped() == 0);
+  assert(mailbox.take(&data) && (int64_t)data.at(0) == 5);
+  assert(!mailbox.fresh() && !mailbox.take(&data));
+  assert(mailbox.latest(&data) == 5 && (int64_t)data.at(0) == 5);
+
+  // 上書きした古い値は引数と交換して返します。
+  Data value = message(6);
+  mailbox.store(value);
+  assert(value.type() == DataType::Array && (int64_t)value.at(0) < 6);
+
+  // 格納側と複数の読み出し側を同時に実行します。
+  const uint32_t STORES = 200000;
+  std::atomic<bool> done(false);
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 3; ++i)
+    readers.emplace_back([&mailbox, &done, i] {
+      // バージョンと値はどちらも増え続け、同じバージョンは同じ値をもちます。
+      uint32_t last_version = 0;
+      int64_t last_value = 0;
+      Data read;
+      while (!done.load()) {
+        uint32_t version = last_version + 1;
+        if (i == 0 ? !mailbox.take(&read) : (version = mailbox.latest(&read)) == 0)
+          continue;
+        assert(read.size() == 2 && read.at(1) == "a value that does not fit inline");
+        int64_t value = read.at(0);
+        assert(version >= last_version && value >= last_value);
+        assert(i == 0 || version != last_version || value == last_value);
+        last_version = version;
+        last_value = value;
+      }
+    });
+  for (uint32_t version = 7; version < 7 + STORES; ++version) {
+    Data stored = message(version);
+    mailbox.store(stored);
+  }
+  done.store(true);
+  for (std::thread& reader : readers)
+    reader.join();
+  // 読み出し中のスロットがなくなれば、最後に格納した値を返します。
+  value = message(0);
+  mailbox.store(value);
+  assert(mailbox.take(&data) && (int64_t)data.at(0) == 0);
+  return 0;
+}
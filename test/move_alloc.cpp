@@ -0,0 +1,90 @@
+/*
+  Dataの移動がメモリを確保せずに値のポインタを引き継ぐことと、
+  受信、読み出し、転送の往復で受信時の領域以外にメモリを確保しないことを確認します。
+*/
+#include "Data.hpp"
+#include "Wireless.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+  ++allocations;
+  void* p = malloc(size);
+  if (p == nullptr)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+int main() {
+  // ヒープ上の文字列
+  Data str = "a string that does not fit inline";
+  const char* chars = str.asString();
+  size_t before = allocations;
+  Data moved(std::move(str));
+  assert(allocations == before && moved.asString() == chars);
+  assert(str.type() == DataType::Null);
+  Data assigned;
+  before = allocations;
+  assigned = std::move(moved);
+  assert(allocations == before && assigned.asString() == chars);
+
+  // 配列
+  Data array = Data{ (int32_t)1, "another string that lives on the heap", 2.5f };
+  const Data* items = &array.at(0);
+  before = allocations;
+  Data moved_array(std::move(array));
+  assert(allocations == before && &moved_array.at(0) == items);
+  Data assigned_array = (int32_t)0;
+  before = allocations;
+  assigned_array = std::move(moved_array);
+  assert(allocations == before && &assigned_array.at(0) == items && assigned_array.size() == 3);
+
+  // std::vectorからの移動は配列の領域だけを確保し、要素の値を複製しません。
+  std::vector<Data> vector;
+  vector.push_back("a long string moved into the array");
+  int32_t numbers[] = { 1, 2, 3 };
+  vector.push_back(Data(numbers, 3));
+  vector.push_back(assigned_array);
+  const char* long_chars = vector[0].asString();
+  const int32_t* numbers_p = vector[1].values<int32_t>();
+  before = allocations;
+  Data from_vector(std::move(vector));
+  assert(allocations == before + 1 && from_vector.size() == 3);
+  assert(from_vector.at(0).asString() == long_chars && from_vector.at(1).values<int32_t>() == numbers_p);
+  assert(&from_vector.at(2).at(0) == items);
+  for (const Data& item : vector)
+    assert(item.type() == DataType::Null);
+
+  // 受信、読み出し、転送
+  wlRxAttach(7000, 1);
+  wlTxAttach(IPAddress(192, 168, 1, 3), 7001, 2);
+  std::vector<uint8_t> packet;
+  assigned_array.serialize(packet, DataEncoding::Fixed);
+  inject(7000, packet.data(), packet.size());
+  assert(wlTxWrite(wlRxRead(1), 2));
+  g_record_sent = false;
+  before = allocations;
+  inject(7000, packet.data(), packet.size());
+  size_t received = allocations - before;
+  before = allocations;
+  Data data = wlRxRead(1);
+  assert(wlTxWrite(data, 2));
+  size_t forwarded = allocations - before;
+  g_record_sent = true;
+  printf("receive: %zu allocation(s), read and forward: %zu allocation(s)\n", received, forwarded);
+  assert(received == 1 && forwarded == 0 && g_sent_count == 2);
+  return 0;
+}
@@ -0,0 +1,28 @@
+#!/bin/sh
+# ホストでテストとベンチマークを実行します。
+# usage: test/run.sh [test/xxx.cpp ...]
+# bench_で始まるファイルは最適化してビルドし、それ以外はサニタイザを有効にしてビルドします。
+set -e
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+OUT=${OUT:-/tmp/esp32wl-test}
+mkdir -p "$OUT"
+if [ $# -eq 0 ]; then
+  set -- "$ROOT"/test/*.cpp
+fi
+failed=0
+for test in "$@"; do
+  name=$(basename "$test" .cpp)
+  case $name in
+    bench_*) flags="-O2" ;;
+    *) flags="-g -O1 -fsanitize=address,undefined" ;;
+  esac
+  g++ -std=gnu++17 $flags -Wall -Wextra -Wno-unused-parameter -I"$ROOT/test/host" -I"$ROOT/esp32" -include Arduino.h \
+    "$ROOT"/esp32/*.cpp "$ROOT/test/host/stubs.cpp" "$test" -o "$OUT/$name" -lpthread
+  if "$OUT/$name"; then
+    echo "PASS $name"
+  else
+    echo "FAIL $name"
+    failed=1
+  fi
+done
+exit $failed
@@ -0,0 +1,68 @@
+/*
+  wlRxWaitAnyが32番以降の受信チャンネルと、待ち始めた後に接続した受信チャンネルでも起きることと、
+  受信を待つ間や、Blockの受信キューが空きを待つ間に、アプリケーションが使用するタスク通知を消費しないことを確認します。
+  ホストの代替実装はarduino-esp32の既定の設定と同じく、タスク通知がタスクごとに1つだけです。
+*/
+#include "Wireless.hpp"
+
+#include <cassert>
+#include <chrono>
+#include <thread>
+
+static void sendLater(uint16_t port, int32_t value, bool attach, uint8_t channel) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  if (attach)
+    wlRxAttach(port, channel);
+  std::vector<uint8_t> packet;
+  Data(value).serialize(packet);
+  inject(port, packet.data(), packet.size());
+}
+
+int main() {
+  // 32番以降の受信チャンネル
+  wlRxAttach(7000, 200);
+  std::thread sender(sendLater, 7000, 1, false, 200);
+  unsigned long start = millis();
+  assert(wlRxWaitAny({ 1, 200 }, 2000) == 200);
+  assert(millis() - start < 1000 && (int32_t)wlRxRead(200) == 1);
+  sender.join();
+  const uint8_t channels[] = { 40, 41 };
+  assert(wlRxWaitAny(channels, 2, 10) == -1);
+
+  // 待ち始めた後に接続した受信チャンネル
+  sender = std::thread(sendLater, 7001, 2, true, 150);
+  start = millis();
+  assert(wlRxWaitAny({ 150 }, 2000) == 150);
+  assert(millis() - start < 1000 && (int32_t)wlRxRead(150) == 2);
+  sender.join();
+  sender = std::thread(sendLater, 7002, 3, true, 151);
+  assert((int32_t)wlRxReadWait(151, 2000) == 3);
+  sender.join();
+
+  // アプリケーションの通知は受信を待った後も残ります。
+  xTaskNotifyGive(xTaskGetCurrentTaskHandle());
+  assert(wlRxReadWait(1, 10).type() == DataType::Null);
+  assert(wlRxWaitAny(1u << 1, 10) == -1);
+  assert(ulTaskNotifyTake(pdTRUE, 0) == 1);
+  // 待ち終わった後に受信しても、アプリケーションのタスクに通知しません。
+  std::vector<uint8_t> packet;
+  Data((int32_t)4).serialize(packet);
+  wlRxAttach(7003, 1);
+  inject(7003, packet.data(), packet.size());
+  assert(ulTaskNotifyTake(pdTRUE, 20) == 0 && (int32_t)wlRxRead(1) == 4);
+
+  // Blockの受信キューで空きを待つ受信タスクも、タスク通知を消費しません。
+  assert(wlRxSetQueue(1, 0, RxOverflow::Block, 2000, 2));
+  wlRxAttach(7004, 2);
+  inject(7004, packet.data(), packet.size());
+  std::thread receiver([&packet] {
+    xTaskNotifyGive(xTaskGetCurrentTaskHandle());
+    inject(7004, packet.data(), packet.size());
+    assert(ulTaskNotifyTake(pdTRUE, 0) == 1);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  assert((int32_t)wlRxRead(2) == 4);
+  receiver.join();
+  assert(wlRxAvailable(2) == 1 && wlRxDropped(2) == 0);
+  return 0;
+}
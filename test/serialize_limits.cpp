@@ -0,0 +1,78 @@
+/*
+  シリアライズできないデータで、serializedSizeとserializeが0を返し、送信されないことを確認します。
+*/
+#include "Data.hpp"
+#include "SerialUtil.hpp"
+#include "Wireless.hpp"
+
+#include <cassert>
+#include <memory>
+#include <vector>
+
+int main() {
+  // 入れ子が深すぎる配列
+  Data nested = (int32_t)1;
+  for (int i = 0; i < DATA_MAX_DEPTH + 1; ++i)
+    nested = Data{ nested };
+  assert(nested.serializedSize() == 0);
+  std::vector<uint8_t> out;
+  assert(nested.serialize(out) == 0 && out.empty());
+  assert(!serialWrite(nested));
+  wlTxAttach(IPAddress(192, 168, 1, 3), 7001, 1);
+  g_sent.clear();
+  assert(!wlTxWrite(nested, 1) && g_sent.empty());
+  // 複数のデータの途中に送信できないデータがある場合は、前のデータも送信しません。
+  Data batch[] = { (int32_t)1, nested, (int32_t)2 };
+  assert(!wlTxWrite(batch, 3, 1) && g_sent.empty());
+  batch[1] = "ok";
+  assert(wlTxWrite(batch, 3, 1) && g_sent.size() == 3);
+  g_sent.clear();
+
+  // 要素数とバイト数はuint16_tで書き込むため、65535までシリアライズできます。
+  const size_t max = 0xFFFF;
+  std::vector<char> chars(max + 1, 'a');
+  Data str(chars.data(), max);
+  assert(str.serializedSize() == 1 + 2 + max);
+  out.clear();
+  assert(str.serialize(out) == 1 + 2 + max);
+  Data decoded;
+  assert(Data::deserialize(out.data(), out.size(), &decoded) && decoded == str);
+  Data long_str(chars.data(), max + 1);
+  assert(long_str.serializedSize() == 0);
+  uint8_t* buf = new uint8_t[max * 2 * 2 + 16];
+  assert(long_str.serialize(buf, max * 2 * 2 + 16) == 0);
+
+  std::vector<int16_t> values(max + 1, 7);
+  Data numbers(values.data(), max);
+  assert(numbers.serializedSize() == 1 + 2 + max * 2);
+  out.clear();
+  assert(numbers.serialize(out) == 1 + 2 + max * 2);
+  assert(Data::deserialize(out.data(), out.size(), &decoded) && decoded == numbers);
+  Data long_numbers(values.data(), max + 1);
+  assert(long_numbers.serializedSize() == 0);
+  assert(long_numbers.serialize(buf, max * 2 * 2 + 16) == 0);
+
+  std::vector<Data> items(max, Data());
+  Data array(items);
+  assert(array.serializedSize() == 1 + 2 + max);
+  items.emplace_back();
+  Data long_array(items);
+  assert(long_array.serializedSize() == 0);
+  assert(long_array.serialize(buf, max * 2 * 2 + 16) == 0);
+  // bool型の配列は要素数を値とともに格納するため、65535を超える場合はNullになります。
+  std::unique_ptr<bool[]> flags(new bool[max + 1]());
+  flags[max - 1] = true;
+  Data bits(flags.get(), max);
+  assert(bits.type() == DataType::BoolArray && bits.size() == max && bits.asBits()[max - 1]);
+  assert(bits.serializedSize() == 1 + 2 + (max + 7) / 8);
+  out.clear();
+  assert(bits.serialize(out) == 1 + 2 + (max + 7) / 8);
+  assert(Data::deserialize(out.data(), out.size(), &decoded) && decoded == bits);
+  Data long_bits(flags.get(), max + 1);
+  assert(long_bits.type() == DataType::Null && long_bits.size() == 0);
+  // 配列の中にある場合も全体をシリアライズできません。
+  Data wrapped{ (int32_t)1, long_str };
+  assert(wrapped.serializedSize() == 0);
+  delete[] buf;
+  return 0;
+}
@@ -0,0 +1,110 @@
+/*
+  serializedSizeStructがシリアライズしたバイト数と一致することと、
+  構造体の送信がバイト数分のバッファだけを確保することを確認します。
+*/
+#include "DataStruct.hpp"
+#include "Wireless.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+static size_t allocations = 0;
+static size_t allocated_bytes = 0;
+
+void* operator new(size_t size) {
+  ++allocations;
+  allocated_bytes += size;
+  void* p = malloc(size);
+  if (p == nullptr)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+struct Wheel {
+  int16_t speed;
+  uint32_t ticks;
+  bool brake;
+};
+WL_STRUCT(Wheel, speed, ticks, brake)
+
+struct Robot {
+  uint8_t id;
+  int64_t position;
+  double heading;
+  float battery;
+  char name[16];
+  std::array<int16_t, 3> accel;
+  std::array<bool, 10> switches;
+  Wheel left;
+  Wheel right;
+};
+WL_STRUCT(Robot, id, position, heading, battery, name, accel, switches, left, right)
+
+struct Log {
+  uint16_t id;
+  char text[1000];
+};
+WL_STRUCT(Log, id, text)
+
+struct Message {
+  String text;
+};
+WL_STRUCT(Message, text)
+
+template<class T>
+static size_t checkSize(const T& value, DataEncoding encoding) {
+  size_t size = serializedSizeStruct(value, encoding);
+  std::vector<uint8_t> buf(size + 16);
+  assert(size != 0 && serializeStruct(value, buf.data(), buf.size(), encoding) == size);
+  assert(serializeStruct(value, buf.data(), size - 1, encoding) == 0);
+  return size;
+}
+
+int main() {
+  Robot robot{ 3, -123456789012, 1.5, 0.75f, "rover", { 1, -300, 20000 }, { true, false, true }, { -5, 1000000, false }, { 70, 3, true } };
+  for (DataEncoding encoding : { DataEncoding::Fixed, DataEncoding::Compact }) {
+    size_t size = checkSize(robot, encoding);
+    Data data{ robot.id, robot.position, robot.heading, robot.battery, "rover", Data(robot.accel.data(), 3),
+               Data(robot.switches.data(), robot.switches.size()),
+               Data{ robot.left.speed, robot.left.ticks, robot.left.brake },
+               Data{ robot.right.speed, robot.right.ticks, robot.right.brake } };
+    assert(size == data.serializedSize(encoding));
+  }
+  Log log{ 1, {} };
+  memset(log.text, 'x', sizeof(log.text) - 1);
+  assert(checkSize(log, DataEncoding::Fixed) == 1 + 2 + 3 + 1 + 2 + 999);
+
+  // 65535文字より長い文字列を含む場合は0を返し、送信しません。
+  Message message{ String(std::string(0x10000, 'a').c_str()) };
+  assert(serializedSizeStruct(message) == 0);
+  message.text = String(std::string(0xFFFF, 'a').c_str());
+  assert(checkSize(message, DataEncoding::Fixed) == 1 + 2 + 1 + 2 + 0xFFFF);
+
+  // スタックに収まる構造体はメモリを確保せず、収まらない構造体はバイト数分だけ確保します。
+  wlTxAttach(IPAddress(192, 168, 1, 3), 7001, 1);
+  g_record_sent = false;
+  size_t before = allocations;
+  assert(wlTxWrite(robot.left, 1));
+  size_t small = allocations - before;
+  before = allocations;
+  size_t before_bytes = allocated_bytes;
+  assert(wlTxWrite(log, 1));
+  size_t large = allocations - before;
+  size_t large_bytes = allocated_bytes - before_bytes;
+  g_record_sent = true;
+  printf("small: %zu allocation(s), large: %zu allocation(s) of %zu byte(s)\n", small, large, large_bytes);
+  assert(small == 0 && large == 1 && large_bytes == serializedSizeStruct(log));
+  assert(g_sent_count == 2);
+  return 0;
+}
@@ -0,0 +1,127 @@
+/*
+  TimeSeriesEncoderで圧縮した時刻と値の組が、シリアライズとデシリアライズを経て
+  TimeSeriesDecoderで同じ値に戻ることと、正しくないデータで範囲外を読まないことを確認します。
+*/
+#include "DataView.hpp"
+#include "TimeSeries.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static const int N = 1000;
+
+int main() {
+  std::vector<uint32_t> times(N);
+  std::vector<float> floats(N);
+  std::vector<double> doubles(N);
+  std::vector<int64_t> ints(N);
+  std::mt19937 rng(1);
+  // 時刻は途中でuint32_tの範囲を一周し、ときどき間隔が揺らぎます。
+  uint32_t time = 0xFFFFF000u;
+  for (int i = 0; i < N; ++i) {
+    time += 100 + (rng() % 5 == 0 ? static_cast<int>(rng() % 7) - 3 : 0);
+    times[i] = time;
+    floats[i] = std::round((20.0f + 2.0f * std::sin(i * 0.01f)) * 10) / 10;
+    doubles[i] = i % 100 == 0 ? NAN : 1000.0 + i * 0.5;
+    ints[i] = 5000 + static_cast<int64_t>(rng() % 21) - 10 - (i == 500 ? 1LL << 40 : 0);
+  }
+  ints[N - 1] = INT64_MIN;
+
+  TimeSeriesEncoder f32(TimeSeriesType::Float32), f64(TimeSeriesType::Float64), i64(TimeSeriesType::Int64);
+  for (int i = 0; i < N; ++i) {
+    assert(f32.append(times[i], floats[i]));
+    assert(f64.append(times[i], doubles[i]));
+    assert(i64.append(times[i], ints[i]));
+  }
+  // 値の型が一致しない組は追加しません。
+  assert(!f32.append(0u, 1.0) && !f64.append(0u, 1) && !i64.append(0u, 1.0f));
+  assert(f32.count() == N);
+
+  Data all{ f32.toData(), f64.toData(), i64.toData() };
+  assert(all.at(0).type() == DataType::TimeSeries && all.at(0).size() == N);
+  assert(f32.encodedSize() == all.at(0).serializedSize());
+  std::vector<uint8_t> buf;
+  assert(all.serialize(buf) != 0);
+
+  // Dataへのデシリアライズ
+  Data received;
+  assert(Data::deserialize(buf.data(), buf.size(), &received) && received == all);
+  TimeSeriesDecoder float_series(received.at(0));
+  assert(float_series.type() == TimeSeriesType::Float32 && float_series.size() == N);
+  uint32_t t;
+  float f;
+  int n = 0;
+  while (float_series.next(&t, &f)) {
+    assert(t == times[n] && f == floats[n]);
+    ++n;
+  }
+  assert(n == N);
+  double d;
+  assert(!TimeSeriesDecoder(received.at(0)).next(&t, &d));
+
+  // DataViewからの読み出し
+  DataView view(buf.data(), buf.size());
+  TimeSeriesDecoder double_series(view[1]);
+  n = 0;
+  while (double_series.next(&t, &d)) {
+    assert(t == times[n] && (std::isnan(doubles[n]) ? std::isnan(d) : d == doubles[n]));
+    ++n;
+  }
+  assert(n == N);
+  TimeSeriesDecoder int_series(view[2]);
+  int64_t v;
+  n = 0;
+  while (int_series.next(&t, &v)) {
+    assert(t == times[n] && v == ints[n]);
+    ++n;
+  }
+  assert(n == N);
+
+  // 空の時系列と1組だけの時系列
+  TimeSeriesEncoder single(TimeSeriesType::Float32);
+  assert(!TimeSeriesDecoder(single.toData()).next(&t, &f));
+  assert(single.append(7u, 1.5f));
+  TimeSeriesDecoder one(single.toData());
+  assert(one.next(&t, &f) && t == 7 && f == 1.5f && !one.next(&t, &f));
+  single.reset();
+  assert(single.count() == 0 && single.toData().size() == 0);
+
+  // 宣言したバイト数を短くしたデータは、すべての組を読み出す前に終わります。
+  std::vector<uint8_t> series;
+  all.at(0).serialize(series);
+  for (size_t len = 0; len < 64; ++len) {
+    std::vector<uint8_t> cut(series.begin(), series.begin() + 6 + len);
+    cut[4] = static_cast<uint8_t>(len);
+    cut[5] = 0;
+    Data truncated;
+    if (!Data::deserialize(cut.data(), cut.size(), &truncated))
+      continue;
+    TimeSeriesDecoder decoder(truncated);
+    n = 0;
+    while (decoder.next(&t, &f))
+      ++n;
+    assert(n < N);
+  }
+
+  // ビットを反転したデータも範囲内だけを読み出します（AddressSanitizerで確認します）。
+  std::vector<uint8_t> ints_bytes;
+  all.at(2).serialize(ints_bytes);
+  for (int k = 0; k < 2000; ++k) {
+    std::vector<uint8_t> broken = ints_bytes;
+    for (int j = 0; j < 5; ++j)
+      broken[6 + rng() % (broken.size() - 6)] ^= 1 << (rng() % 8);
+    Data corrupted;
+    assert(Data::deserialize(broken.data(), broken.size(), &corrupted));
+    TimeSeriesDecoder decoder(corrupted);
+    while (decoder.next(&t, &v)) {}
+  }
+
+  // 値の型が正しくない場合はデシリアライズしません。
+  series[1] = 9;
+  assert(!Data::deserialize(series.data(), series.size(), &received));
+  assert(!DataView(series.data(), series.size()).valid());
+  return 0;
+}